@@ -0,0 +1,255 @@
+/*
+ * Bench.cpp - cycle counts of the firmware's hot paths, run under simavr
+ *
+ * Built into the firmware by env:bench, which defines SYS_BENCH so setup()
+ * calls benchRun() once everything is up. Each benchmark calls one path a
+ * number of times with interrupts off and times every call on Timer1
+ * running at the CPU clock, so the counts are exact AVR cycles, less the
+ * cost of an empty call. Timer1 is taken from the LED PWM for this, and
+ * the run ends by sleeping with interrupts off, which is how simavr is
+ * told to stop.
+ *
+ * Commands and pushes go through the firmware's own CmdMessenger, moved
+ * onto a stream that replays a canned line and throws the output away,
+ * so serial line speed stays out of the counts.
+ *
+ * Results go out on Serial as one line per benchmark:
+ *
+ *   bench,name,calls,min,mean,max
+ *
+ * then a bench-info line with the overhead taken off each call. bench.sh
+ * turns these into a table and compares two runs. A max of 65535 marks a
+ * call that ran past the 16 bit count.
+ */
+
+#include <Arduino.h>
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include <string.h>
+
+#include "SparkFunBME280.h"
+#include "CmdMessenger.h"
+
+#define BENCH_MAX					12
+#define BENCH_CALLS				200
+#define BENCH_TICKS				1000		// sysTaskTimer calls, enough to pass every % branch
+
+// datasheet sample readings: 25.08 DegC and 100653 Pa, about 45 %RH
+#define BENCH_ADC_T				519888L
+#define BENCH_ADC_P				415148L
+#define BENCH_ADC_H				27000L
+
+// from main.cpp
+extern CmdMessenger cmdMessenger;
+extern BME280 climateSensor;
+extern uint32_t sysTaskCounter;
+extern uint32_t sysDataPushInterval;
+extern bool sensorDataReady;
+extern bool ledFadeFlag;
+extern uint8_t ledFadeTarget;
+void sysTaskTimer(void);
+void sysTaskProcessor(void);
+void ledController(void);
+
+//feeds one line to CmdMessenger and counts what comes back
+class BenchStream : public Stream
+{
+public:
+	BenchStream() : _in(""), _written(0) {}
+	void load(const char *line) { _in = line; }
+	uint32_t written() const { return _written; }
+
+	int available() { return strlen(_in); }
+	int read() { return *_in ? *_in++ : -1; }
+	int peek() { return *_in ? *_in : -1; }
+	void flush() {}
+	size_t write(uint8_t c) { (void)c; _written++; return 1; }
+	using Print::write;
+
+private:
+	const char *_in;
+	uint32_t _written;
+};
+
+struct BenchResult
+{
+	const __FlashStringHelper *name;
+	uint16_t calls;
+	uint16_t min;
+	uint16_t max;
+	uint32_t total;
+};
+
+static BenchStream benchStream;
+static BenchResult benchResults[BENCH_MAX];
+static uint8_t benchCount;
+static uint16_t benchOverhead;
+static uint16_t benchIndex;						//call number, for prepare functions
+static const char *benchLine;
+static volatile uint32_t benchSink;		//keeps results the compiler would drop
+
+static void __attribute__((noinline)) benchNothing(void)
+{
+}
+
+//cycles for one call, from the TCNT1 write to the TCNT1 read
+static uint16_t benchCall(void (*fn)(void))
+{
+	TIFR1 = _BV(TOV1);
+	TCNT1 = 0;
+	fn();
+	uint16_t cycles = TCNT1;
+	if (TIFR1 & _BV(TOV1)) {
+		return 0xFFFF;
+	}
+	return cycles;
+}
+
+static void bench(const __FlashStringHelper *name, void (*prepare)(void), void (*fn)(void), uint16_t calls)
+{
+	if (benchCount >= BENCH_MAX) {
+		return;
+	}
+	BenchResult &result = benchResults[benchCount++];
+	result.name = name;
+	result.calls = calls;
+	result.min = 0xFFFF;
+	result.max = 0;
+	result.total = 0;
+	for (benchIndex = 0; benchIndex < calls; benchIndex++)
+	{
+		if (prepare) {
+			prepare();
+		}
+		uint16_t cycles = benchCall(fn);
+		if (cycles != 0xFFFF) {
+			cycles = (cycles > benchOverhead) ? cycles - benchOverhead : 0;
+		}
+		if (cycles < result.min) {
+			result.min = cycles;
+		}
+		if (cycles > result.max) {
+			result.max = cycles;
+		}
+		result.total += cycles;
+	}
+}
+
+static void benchCommand(void)
+{
+	cmdMessenger.feedinSerialData();
+}
+
+static void benchLoadLine(void)
+{
+	benchStream.load(benchLine);
+}
+
+static void benchCompensateTemp(void)
+{
+	benchSink = climateSensor.compensateTemp(BENCH_ADC_T + benchIndex);
+}
+
+static void benchCompensatePressure(void)
+{
+	benchSink = climateSensor.compensatePressure(BENCH_ADC_P + benchIndex);
+}
+
+static void benchCompensateHumidity(void)
+{
+	benchSink = climateSensor.compensateHumidity(BENCH_ADC_H + benchIndex);
+}
+
+//a new target every call, so each one starts a fade as well as steps it
+static void benchFadeStep(void)
+{
+	ledFadeFlag = true;
+	ledFadeTarget = (benchIndex & 1) ? 100 : 0;
+}
+
+//have the next tick raise SYS_TASK_PUSH_DATA the way it does on the device
+static void benchPushDue(void)
+{
+	sysTaskCounter = sysDataPushInterval - 1;
+	sysTaskTimer();
+	sensorDataReady = true;
+}
+
+static void benchPrintNumber(void)
+{
+	benchStream.print(4294967295UL - benchIndex);
+}
+
+static void benchCommands(const __FlashStringHelper *name, const char *line)
+{
+	benchLine = line;
+	bench(name, benchLoadLine, benchCommand, BENCH_CALLS);
+}
+
+void benchRun(void)
+{
+	// the datasheet example trimming for T and P, a typical part for H
+	SensorCalibration &cal = climateSensor.calibration;
+	cal.dig_T1 = 27504; cal.dig_T2 = 26435; cal.dig_T3 = -1000;
+	cal.dig_P1 = 36477; cal.dig_P2 = -10685; cal.dig_P3 = 3024;
+	cal.dig_P4 = 2855; cal.dig_P5 = 140; cal.dig_P6 = -7;
+	cal.dig_P7 = 15500; cal.dig_P8 = -14600; cal.dig_P9 = 6000;
+	cal.dig_H1 = 75; cal.dig_H2 = 367; cal.dig_H3 = 0;
+	cal.dig_H4 = 296; cal.dig_H5 = 50; cal.dig_H6 = 30;
+
+	Serial.flush();
+	cmdMessenger.setStream(benchStream);
+	// push every channel, so the push bench formats all of them
+	benchStream.load("5,1;");
+	cmdMessenger.feedinSerialData();
+
+	cli();
+	TIMSK1 = 0;
+	TCCR1A = 0;
+	TCCR1B = _BV(CS10);
+	benchOverhead = 0;
+	bench(F("overhead"), NULL, benchNothing, BENCH_CALLS);
+	benchOverhead = benchResults[0].min;
+	benchCount = 0;
+
+	bench(F("sysTaskTimer"), NULL, sysTaskTimer, BENCH_TICKS);
+	benchCommands(F("cmdQueryTemp"), "11;");
+	benchCommands(F("cmdQueryPushConfig"), "47;");
+	benchCommands(F("cmdSetPushMode"), "5,1;");
+	bench(F("bme280Temp"), NULL, benchCompensateTemp, BENCH_CALLS);
+	bench(F("bme280Pressure"), NULL, benchCompensatePressure, BENCH_CALLS);
+	bench(F("bme280Humidity"), NULL, benchCompensateHumidity, BENCH_CALLS);
+	bench(F("ledControllerIdle"), NULL, ledController, BENCH_CALLS);
+	bench(F("ledControllerFade"), benchFadeStep, ledController, BENCH_CALLS);
+	bench(F("pushData"), benchPushDue, sysTaskProcessor, BENCH_CALLS);
+	bench(F("printUint32"), NULL, benchPrintNumber, BENCH_CALLS);
+	sei();
+
+	for (uint8_t i = 0; i < benchCount; i++)
+	{
+		const BenchResult &result = benchResults[i];
+		Serial.print(F("bench,"));
+		Serial.print(result.name);
+		Serial.print(',');
+		Serial.print(result.calls);
+		Serial.print(',');
+		Serial.print(result.min);
+		Serial.print(',');
+		Serial.print(result.total / result.calls);
+		Serial.print(',');
+		Serial.println(result.max);
+	}
+	// what was taken off each call, and how much the commands sent back
+	Serial.print(F("bench-info,overhead,"));
+	Serial.print(benchOverhead);
+	Serial.print(F(",written,"));
+	Serial.println(benchStream.written());
+	Serial.flush();
+
+	cli();
+	set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+	sleep_enable();
+	sleep_cpu();
+	for (;;) {
+	}
+}
@@ -0,0 +1,96 @@
+#!/bin/sh
+#
+# bench.sh - run the cycle benchmarks under simavr and print a table
+#
+#   pio run -e bench && bench/bench.sh [-s results.txt] [-c baseline.txt] [elf]
+#
+#   -s FILE   keep the raw bench lines, to compare a later run against,
+#             under a comment naming the compiler that built the elf
+#   -c FILE   add the change from an earlier run's saved lines; without
+#             -c the run is compared with bench/baseline.txt if it exists
+#
+# The elf defaults to the env:bench build. SIMAVR names the simavr binary
+# (simavr, or run_avr on older installs). The run stops by itself when
+# benchRun() sleeps with interrupts off.
+
+SIMAVR=${SIMAVR:-simavr}
+MCU=atmega328p
+FREQ=8000000
+
+save=
+compare=
+while getopts s:c: opt
+do
+	case $opt in
+		s) save=$OPTARG ;;
+		c) compare=$OPTARG ;;
+		*) echo "usage: bench.sh [-s results.txt] [-c baseline.txt] [elf]" >&2; exit 2 ;;
+	esac
+done
+shift $((OPTIND - 1))
+elf=${1:-.pio/build/bench/firmware.elf}
+if [ -z "$compare" ] && [ -f "$(dirname "$0")/baseline.txt" ]; then
+	compare=$(dirname "$0")/baseline.txt
+fi
+
+if [ ! -f "$elf" ]; then
+	echo "bench.sh: no $elf, build it with: pio run -e bench" >&2
+	exit 2
+fi
+
+out=$(mktemp)
+trap 'rm -f "$out"' EXIT
+
+# simavr echoes the UART a line at a time, possibly with a prefix or colour
+# codes, so pick the bench lines out wherever they are
+timeout 120 "$SIMAVR" -m $MCU -f $FREQ "$elf" 2>&1 |
+	tr -d '\r' | grep -ao 'bench[-a-z]*,[A-Za-z0-9_,]*' > "$out"
+
+if ! grep -q '^bench,' "$out"; then
+	echo "bench.sh: no results from $SIMAVR" >&2
+	exit 1
+fi
+
+# cycle counts move with the compiler, so a saved run says which one it was
+compiler=$(strings -a "$elf" | grep -m 1 '^GCC: ')
+if [ -n "$save" ]; then
+	{
+		echo "# ${compiler:-compiler unknown}"
+		grep '^bench,' "$out"
+	} > "$save"
+fi
+if [ -n "$compare" ]; then
+	was=$(sed -n 's/^# //p' "$compare" | head -n 1)
+	if [ -n "$was" ] && [ "$was" != "$compiler" ]; then
+		echo "bench.sh: $compare was built with $was, this elf with ${compiler:-an unknown compiler}" >&2
+	fi
+fi
+
+awk -F, -v base="$compare" '
+	BEGIN {
+		if (base != "") {
+			while ((getline line < base) > 0) {
+				split(line, f, ",")
+				if (f[1] == "bench") old[f[2]] = f[5]
+			}
+		}
+		if (base != "")
+			printf "%-20s %6s %8s %8s %8s %8s %8s\n", "benchmark", "calls", "min", "mean", "max", "was", "change"
+		else
+			printf "%-20s %6s %8s %8s %8s\n", "benchmark", "calls", "min", "mean", "max"
+	}
+	$1 == "bench-info" { info = sprintf("cycles at %d MHz, less %d for the call itself", '$FREQ' / 1000000, $3); next }
+	$1 == "bench" {
+		if (base == "") {
+			printf "%-20s %6d %8d %8d %8d\n", $2, $3, $4, $5, $6
+		}
+		else if ($2 in old) {
+			change = (old[$2] > 0) ? sprintf("%+.1f%%", ($5 - old[$2]) * 100 / old[$2]) : "-"
+			printf "%-20s %6d %8d %8d %8d %8d %8s\n", $2, $3, $4, $5, $6, old[$2], change
+		}
+		else {
+			printf "%-20s %6d %8d %8d %8d %8s %8s\n", $2, $3, $4, $5, $6, "-", "new"
+		}
+	}
+	END { if (info != "") print info }
+' "$out"
@@ -166,6 +166,11 @@ uint32_t BME280::readPressure( void )
 	// Output value of “24674867” represents 24674867/256 = 96386.2 Pa = 963.862 hPa
 	int32_t adc_P = ((uint32_t)readRegister(BME280_PRESSURE_MSB_REG) << 12) | ((uint32_t)readRegister(BME280_PRESSURE_LSB_REG) << 4) | ((readRegister(BME280_PRESSURE_XLSB_REG) >> 4) & 0x0F);
 
+	return compensatePressure(adc_P);
+}
+
+uint32_t BME280::compensatePressure( int32_t adc_P )
+{
 	int64_t var1, var2, p_acc;
 	var1 = ((int64_t)t_fine) - 128000;
 	var2 = var1 * var1 * (int64_t)calibration.dig_P6;
@@ -201,6 +206,11 @@ uint16_t BME280::readHumidity( void )
 	// Output value of “47445” represents 47445/1024 = 46. 333 %RH
 	int32_t adc_H = ((uint32_t)readRegister(BME280_HUMIDITY_MSB_REG) << 8) | ((uint32_t)readRegister(BME280_HUMIDITY_LSB_REG));
 
+	return compensateHumidity(adc_H);
+}
+
+uint16_t BME280::compensateHumidity( int32_t adc_H )
+{
 	int32_t var1;
 	var1 = (t_fine - ((int32_t)76800));
 	var1 = (((((adc_H << 14) - (((int32_t)calibration.dig_H4) << 20) - (((int32_t)calibration.dig_H5) * var1)) +
@@ -231,6 +241,15 @@ uint16_t BME280::readTempC( void )
 	//get the reading (adc_T);
 	int32_t adc_T = ((uint32_t)readRegister(BME280_TEMPERATURE_MSB_REG) << 12) | ((uint32_t)readRegister(BME280_TEMPERATURE_LSB_REG) << 4) | ((readRegister(BME280_TEMPERATURE_XLSB_REG) >> 4) & 0x0F);
 
+	uint16_t temperature = compensateTemp(adc_T);
+
+	//output = output / 100;
+
+	return temperature/10;
+}
+
+int32_t BME280::compensateTemp( int32_t adc_T )
+{
 	//By datasheet, calibrate
 	int64_t var1, var2;
 
@@ -238,11 +257,7 @@ uint16_t BME280::readTempC( void )
 	var2 = (((((adc_T>>4) - ((int32_t)calibration.dig_T1)) * ((adc_T>>4) - ((int32_t)calibration.dig_T1))) >> 12) *
 	((int32_t)calibration.dig_T3)) >> 14;
 	t_fine = var1 + var2;
-	uint16_t temperature = (t_fine * 5 + 128) >> 8;
-
-	//output = output / 100;
-
-	return temperature/10;
+	return (t_fine * 5 + 128) >> 8;
 }
 
 //float BME280::readTempF( void )
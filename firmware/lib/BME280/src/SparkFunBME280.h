@@ -167,6 +167,12 @@ class BME280
   uint16_t readTempC( void );
   //float readTempF( void );
 
+	//The datasheet compensation of raw ADC words, as the read methods use it.
+	//Temperature sets t_fine, which the other two depend on.
+	int32_t compensateTemp( int32_t adc_T );		//0.01 DegC
+	uint32_t compensatePressure( int32_t adc_P );	//Pa
+	uint16_t compensateHumidity( int32_t adc_H );	//%RH
+
   //The following utilities read and write
 
 	//ReadRegisterRegion takes a uint8 array address as input and reads
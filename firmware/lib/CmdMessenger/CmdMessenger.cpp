@@ -101,6 +101,14 @@ void CmdMessenger::printLfCr(bool addNewLine)
 	print_newlines = addNewLine;
 }
 
+/**
+ * Moves to another stream, keeping the callbacks and the message state
+ */
+void CmdMessenger::setStream(Stream &ccomms)
+{
+	comms = &ccomms;
+}
+
 /**
  * Attaches an default function for commands that are not explicitly attached
  */
@@ -327,6 +335,21 @@ void CmdMessenger::sendCmdSciArg(double arg, unsigned int n)
 	}
 }
 
+/**
+ * Send a buffer of bytes as a single binary argument
+ *  Note that this will only succeed if a sendCmdStart has been issued first
+ */
+void CmdMessenger::sendCmdBinArg(const byte *data, uint8_t size)
+{
+	if (startCommand)
+	{
+		comms->print(field_separator);
+		for (uint8_t i = 0; i < size; i++) {
+			printEsc((char)data[i]);
+		}
+	}
+}
+
 /**
  * Send end of command
  */
@@ -489,7 +512,7 @@ char* CmdMessenger::readStringArg()
 		return current;
 	}
 	ArgOk = false;
-	return '\0';
+	return NULL;
 }
 
 /**
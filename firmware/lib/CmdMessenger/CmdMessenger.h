@@ -40,9 +40,9 @@ extern "C"
 	typedef void(*messengerCallbackFunction) (void);
 }
 
-#define MAXCALLBACKS        50   // The maximum number of commands   (default: 50)
-#define MESSENGERBUFFERSIZE 64   // The length of the commandbuffer  (default: 64)
-#define MAXSTREAMBUFFERSIZE 512  // The length of the streambuffer   (default: 64)
+#define MAXCALLBACKS        67   // The maximum number of commands   (default: 50)
+#define MESSENGERBUFFERSIZE 224  // The length of the commandbuffer  (default: 64)
+#define MAXSTREAMBUFFERSIZE 64   // The length of the streambuffer   (default: 64)
 #define DEFAULT_TIMEOUT     5000 // Time out on unanswered messages. (default: 5s)
 
 // Message States
@@ -169,6 +169,7 @@ public:
 		const char esc_character = '/');
 
 	void printLfCr(bool addNewLine = true);
+	void setStream(Stream & comms);
 	void attach(messengerCallbackFunction newFunction);
 	void attach(byte msgId, messengerCallbackFunction newFunction);
 
@@ -253,6 +254,11 @@ public:
 	 */
 	void sendCmdSciArg(double arg, unsigned int n = 6);
 
+	/**
+	 * Send a buffer of bytes as a single binary argument
+	 */
+	void sendCmdBinArg(const byte *data, uint8_t size);
+
 
 	/**
 	 * Send a single argument in binary format
@@ -0,0 +1,79 @@
+/*
+  EEPROMVar.cpp - EEPROM variable registry
+  Copyright (c) 2012 Thijs Elenbaas.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "EEPROMVar.h"
+
+/******************************************************************************
+ * Registry
+ ******************************************************************************/
+
+// starts dirty, the initial value is not in the EEPROM until written or restored
+EEPROMVarBase::EEPROMVarBase(int address):
+	address(address),
+	dirty(true),
+	next(first)
+{
+	first = this;
+}
+
+/**
+ * Flag a changed value and restart the quiet period
+ */
+void EEPROMVarBase::markDirty()
+{
+	dirty = true;
+	_lastChange = millis();
+}
+
+/**
+ * Write every dirty variable. Returns the number of variables written
+ */
+uint8_t EEPROMVarBase::commitDirty()
+{
+	uint8_t count = 0;
+	for (EEPROMVarBase *var = first; var != NULL; var = var->next) {
+		if (var->dirty) {
+			var->commit();
+			count++;
+		}
+	}
+	return count;
+}
+
+/**
+ * Returns true if any variable has changed since it was last written
+ */
+bool EEPROMVarBase::anyDirty()
+{
+	for (EEPROMVarBase *var = first; var != NULL; var = var->next) {
+		if (var->dirty) return true;
+	}
+	return false;
+}
+
+/**
+ * millis() at the most recent change of any variable
+ */
+uint32_t EEPROMVarBase::lastChange()
+{
+	return _lastChange;
+}
+
+EEPROMVarBase *EEPROMVarBase::first = NULL;
+uint32_t EEPROMVarBase::_lastChange = 0;
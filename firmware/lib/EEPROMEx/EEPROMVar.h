@@ -24,55 +24,104 @@
 #ifndef EEPROMVAR_h
 #define EEPROMVAR_h
 
-template<typename T> class EEPROMVar 
+/*
+ * Every EEPROMVar registers itself on creation. Changing a variable marks
+ * it dirty, and commitDirty() writes all dirty variables in one pass through
+ * the write queue, so a burst of changes costs a single set of writes.
+ */
+class EEPROMVarBase
+{
+	public:
+	  static uint8_t commitDirty();
+	  static bool anyDirty();
+	  static uint32_t lastChange();
+
+	  bool isDirty() {
+		return dirty;
+	  }
+	protected:
+	  EEPROMVarBase(int address);
+	  // a copy would not be in the registry
+	  EEPROMVarBase(const EEPROMVarBase&) = delete;
+	  void markDirty();
+	  virtual void commit() = 0;
+
+	  int address;
+	  bool dirty;
+	private:
+	  EEPROMVarBase *next;
+	  static EEPROMVarBase *first;
+	  static uint32_t _lastChange;
+};
+
+template<typename T> class EEPROMVar : public EEPROMVarBase
 {
 	public:
 	  EEPROMVar(const T& init):
-		var(init),
-		address(EEPROM.getAddress(sizeof(T)))
+		EEPROMVarBase(EEPROM.getAddress(sizeof(T))),
+		var(init)
+	  {
+	  }
+
+	  EEPROMVar(const T& init, int address):
+		EEPROMVarBase(address),
+		var(init)
 	  {
 	  }
 
-	  operator T () { 
+	  operator T () const { 
 		return var; 
 	  }
 	  EEPROMVar &operator=(const T& val) {
-		var = val;
+		if (!(var == val)) {
+			var = val;
+			markDirty();
+		}
 		return *this;
 	  }
 	  
 	  void operator+=(T val) {
 		var += T(val); 
+		markDirty();
 	  }
 	  void operator-=(T val) {
 		var -= T(val); 
+		markDirty();
 	  }	 	  
 	  void operator++(int) {
 		var += T(1); 
+		markDirty();
 	  }
 	  void operator--(int) {
 		var -= T(1); 
+		markDirty();
 	  }
 	  void operator++() {
 		var += T(1); 
+		markDirty();
 	  }
 	  void operator--() {
 		var -= T(1); 
+		markDirty();
 	  }
 	  template<typename V>
 		void operator /= (V divisor) {
 		var = var / divisor;
+		markDirty();
 	  }
 	  template<typename V>
 		void operator *= (V multiplicator) {
 		var = var * multiplicator;
+		markDirty();
 	  }
 	  void save(){	   	   
 	    EEPROM.writeBlock<T>(address, var);
+	    dirty = false;
 	  }
 	  
 	  void update(){	   	   
 	    EEPROM.updateBlock<T>(address, var);
+	    dirty = false;
 	  }
 	  
 	  int getAddress(){	   	   
@@ -81,10 +130,18 @@ template<typename T> class EEPROMVar
 	  
 	  void restore(){
 	  	EEPROM.readBlock<T>(address, var);
+	  	dirty = false;
 	  }
 	protected:	
+	  // queued when there is room, otherwise written straight away
+	  void commit(){
+	    if (EEPROM.queueUpdateBlock<T>(address, var) == 0) {
+	    	EEPROM.updateBlock<T>(address, var);
+	    }
+	    dirty = false;
+	  }
+
 	  T var;
-	  int address;
 };
 
 #endif //EEPROMVAR_h
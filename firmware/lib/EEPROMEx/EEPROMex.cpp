@@ -21,6 +21,7 @@
  * Includes
  ******************************************************************************/
 #include "EEPROMex.h"
+#include <avr/interrupt.h>
 
 /******************************************************************************
  * Definitions
@@ -37,7 +38,13 @@
 // Boards with ATmega168, Lilypad, old Nano, Diecimila  – 512 bytes
 // By default we choose conservative settings
 EEPROMClassEx::EEPROMClassEx()
-  :  _allowedWrites(100)
+  :  _allowedWrites(100),
+     _journalBase(0),
+     _journalSlots(0),
+     _journalRecordSize(0),
+     _journalHead(-1),
+     _journalSeq(0),
+     _journalBytesWritten(0)
 {
 }
  
@@ -117,7 +124,9 @@ uint8_t EEPROMClassEx::read(int address)
 bool EEPROMClassEx::readBit(int address, byte bit) {
 	  if (bit> 7) return false; 
 	  if (!isReadOk(address+sizeof(uint8_t))) return false;
+	  uint8_t queue = queuePause();
 	  byte byteVal =  eeprom_read_byte((unsigned char *) address);      
+	  queueResume(queue);
 	  byte bytePos = (1 << bit);
       return (byteVal & bytePos);
 }
@@ -128,7 +137,10 @@ bool EEPROMClassEx::readBit(int address, byte bit) {
 uint8_t EEPROMClassEx::readByte(int address)
 {	
 	if (!isReadOk(address+sizeof(uint8_t))) return 0;
-	return eeprom_read_byte((unsigned char *) address);
+	uint8_t queue = queuePause();
+	uint8_t value = eeprom_read_byte((unsigned char *) address);
+	queueResume(queue);
+	return value;
 }
 
 /**
@@ -137,7 +149,10 @@ uint8_t EEPROMClassEx::readByte(int address)
 uint16_t EEPROMClassEx::readInt(int address)
 {
 	if (!isReadOk(address+sizeof(uint16_t))) return 0;
-	return eeprom_read_word((uint16_t *) address);
+	uint8_t queue = queuePause();
+	uint16_t value = eeprom_read_word((uint16_t *) address);
+	queueResume(queue);
+	return value;
 }
 
 /**
@@ -146,7 +161,10 @@ uint16_t EEPROMClassEx::readInt(int address)
 uint32_t EEPROMClassEx::readLong(int address)
 {
 	if (!isReadOk(address+sizeof(uint32_t))) return 0;
-	return eeprom_read_dword((unsigned long *) address);
+	uint8_t queue = queuePause();
+	uint32_t value = eeprom_read_dword((unsigned long *) address);
+	queueResume(queue);
+	return value;
 }
 
 /**
@@ -194,6 +212,7 @@ bool EEPROMClassEx::writeBit(int address, uint8_t bit, bool value) {
 bool EEPROMClassEx::writeByte(int address, uint8_t value)
 {
 	if (!isWriteOk(address+sizeof(uint8_t))) return false;
+	flush();
 	eeprom_write_byte((unsigned char *) address, value);
 	return true;
 }
@@ -204,6 +223,7 @@ bool EEPROMClassEx::writeByte(int address, uint8_t value)
 bool EEPROMClassEx::writeInt(int address, uint16_t value)
 {
 	if (!isWriteOk(address+sizeof(uint16_t))) return false;
+	flush();
 	eeprom_write_word((uint16_t *) address, value);
 	return true;
 }
@@ -214,6 +234,7 @@ bool EEPROMClassEx::writeInt(int address, uint16_t value)
 bool EEPROMClassEx::writeLong(int address, uint32_t value)
 {
 	if (!isWriteOk(address+sizeof(uint32_t))) return false;
+	flush();
 	eeprom_write_dword((unsigned long *) address, value);
 	return true;
 }
@@ -313,6 +334,301 @@ bool EEPROMClassEx::updateDouble(int address, double value)
 	return (writeBlock<double>(address, value)!=0);
 }
 
+/******************************************************************************
+ * Write queue
+ *
+ * A byte write takes about 3.3 ms. Queued writes return at once and are
+ * carried out one at a time from the EE_READY interrupt, which fires each
+ * time the EEPROM finishes the previous write. A byte that already holds
+ * the queued value is skipped, as with update(). Blocking writes flush the
+ * queue first, and reads hold the interrupt off, so both can still be used.
+ ******************************************************************************/
+
+/**
+ * Queue a single byte update. Returns false if the queue is full
+ */
+bool EEPROMClassEx::queueUpdate(int address, uint8_t value)
+{
+	if (!isWriteOk(address+sizeof(uint8_t))) return false;
+	uint8_t next = (_queueTail + 1) % EEPROM_QUEUE_SIZE;
+	if (next == _queueHead) return false;
+	_queue[_queueTail].address = address;
+	_queue[_queueTail].value = value;
+	_queueTail = next;
+	EECR |= _BV(EERIE);
+	return true;
+}
+
+/**
+ * Returns true when every queued byte has been written
+ */
+bool EEPROMClassEx::queueIdle()
+{
+	return _queueHead == _queueTail && !(EECR & _BV(EERIE));
+}
+
+/**
+ * Number of bytes that can still be queued
+ */
+uint8_t EEPROMClassEx::queueFree()
+{
+	return (EEPROM_QUEUE_SIZE - 1) - ((_queueTail + EEPROM_QUEUE_SIZE - _queueHead) % EEPROM_QUEUE_SIZE);
+}
+
+/**
+ * Write out everything still queued, blocking until done
+ */
+void EEPROMClassEx::flush()
+{
+	if (queueIdle()) return;
+	// keep the interrupt out for good and drain from here; queueStep never
+	// sets EERIE, so nothing can start a write behind our back
+	EECR &= ~_BV(EERIE);
+	do {
+		eeprom_busy_wait();
+	} while (queueStep());
+	if (_queueCallback != NULL) _queueCallback();
+}
+
+/**
+ * Set a function to call once the queue has drained: from the interrupt,
+ * or from the main program when flush() drains it for a blocking write
+ */
+void EEPROMClassEx::setQueueCallback(void (*callback)())
+{
+	_queueCallback = callback;
+}
+
+/**
+ * Bytes physically written by the queue since power up
+ */
+uint16_t EEPROMClassEx::queueBytesWritten()
+{
+	return _queueBytesWritten;
+}
+
+/**
+ * Start the next queued write that changes a byte, false once the queue is
+ * empty. Must be called with the EEPROM ready and leaves EERIE alone
+ */
+bool EEPROMClassEx::queueStep()
+{
+	while (_queueHead != _queueTail) {
+		uint16_t address = _queue[_queueHead].address;
+		uint8_t value = _queue[_queueHead].value;
+		_queueHead = (_queueHead + 1) % EEPROM_QUEUE_SIZE;
+		if (eeprom_read_byte((unsigned char *) address) != value) {
+			eeprom_write_byte((unsigned char *) address, value);
+			_queueBytesWritten++;
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * The EE_READY interrupt: the next write, or the callback once drained
+ */
+void EEPROMClassEx::queueService()
+{
+	if (queueStep()) {
+		// eeprom_write_byte clears EERIE when it selects the programming mode
+		EECR |= _BV(EERIE);
+		return;
+	}
+	EECR &= ~_BV(EERIE);
+	if (_queueCallback != NULL) _queueCallback();
+}
+
+/**
+ * Hold off the interrupt and wait for a queued write in progress, so a
+ * read from the main program cannot race a write started by the interrupt
+ */
+uint8_t EEPROMClassEx::queuePause()
+{
+	uint8_t queue = EECR & _BV(EERIE);
+	if (queue) {
+		EECR &= ~_BV(EERIE);
+		eeprom_busy_wait();
+	}
+	return queue;
+}
+
+void EEPROMClassEx::queueResume(uint8_t queue)
+{
+	if (queue) EECR |= _BV(EERIE);
+}
+
+ISR(EE_READY_vect)
+{
+	EEPROMClassEx::queueService();
+}
+
+/******************************************************************************
+ * Journal
+ *
+ * The journal spreads repeated saves of one record over a region of the
+ * EEPROM. Each slot holds a 32 bit sequence number, the record and a
+ * CRC-16 over both. Writes go to the slot after the newest one, and the
+ * sequence number is written last so a torn write fails its CRC and the
+ * previous record stays the newest.
+ ******************************************************************************/
+
+#define JOURNAL_SLOT_OVERHEAD (sizeof(uint32_t) + sizeof(uint16_t))
+#define JOURNAL_SEQ_ERASED    0xFFFFFFFF
+
+/**
+ * Set up a journal of records of recordSize bytes in memSize bytes from base,
+ * and scan it for the newest valid record. Returns true if one was found
+ */
+bool EEPROMClassEx::journalBegin(int base, int memSize, int recordSize)
+{
+	_journalBase = base;
+	_journalRecordSize = recordSize;
+	_journalSlots = memSize / (recordSize + JOURNAL_SLOT_OVERHEAD);
+	_journalHead = -1;
+	_journalSeq = 0;
+
+	for (int slot = 0; slot < _journalSlots; slot++) {
+		uint32_t seq = readLong(journalSlotAddress(slot));
+		if (seq == JOURNAL_SEQ_ERASED) continue;
+		// only older than the newest found so far, no need to check the CRC
+		if (_journalHead >= 0 && (int32_t)(seq - _journalSeq) <= 0) continue;
+		if (readInt(journalSlotAddress(slot) + sizeof(uint32_t) + _journalRecordSize) != journalCrc(slot, seq)) continue;
+		_journalHead = slot;
+		_journalSeq = seq;
+	}
+	return _journalHead >= 0;
+}
+
+/**
+ * Copy the newest record to data. Returns false if the journal is empty
+ */
+bool EEPROMClassEx::journalRead(void *data)
+{
+	if (_journalHead < 0) return false;
+	uint8_t queue = queuePause();
+	eeprom_read_block(data, (const void*)(journalSlotAddress(_journalHead) + sizeof(uint32_t)), _journalRecordSize);
+	queueResume(queue);
+	return true;
+}
+
+/**
+ * Append a record to the journal, overwriting the oldest slot. A queued
+ * write returns straight away and is finished by the write queue
+ */
+bool EEPROMClassEx::journalWrite(const void *data, bool queued)
+{
+	if (_journalSlots == 0) return false;
+	int slot = (_journalHead + 1) % _journalSlots;
+	uint32_t seq = _journalSeq + 1;
+	if (seq == JOURNAL_SEQ_ERASED) seq = 0;
+	int address = journalSlotAddress(slot);
+	if (!isWriteOk(address + _journalRecordSize + JOURNAL_SLOT_OVERHEAD)) return false;
+
+	const byte* bytePointer = (const byte*)data;
+	uint16_t crc = journalCrc(data, seq);
+	int slotSize = _journalRecordSize + JOURNAL_SLOT_OVERHEAD;
+	if (queued && slotSize < EEPROM_QUEUE_SIZE) {
+		if (queueFree() < slotSize) flush();
+		for (int i = 0; i < _journalRecordSize; i++) {
+			queueUpdate(address + sizeof(uint32_t) + i, bytePointer[i]);
+		}
+		queueUpdateBlock<uint16_t>(address + sizeof(uint32_t) + _journalRecordSize, crc);
+		queueUpdateBlock<uint32_t>(address, seq);
+	} else {
+		for (int i = 0; i < _journalRecordSize; i++) {
+			_journalBytesWritten += updateBlock<uint8_t>(address + sizeof(uint32_t) + i, bytePointer[i]);
+		}
+		_journalBytesWritten += updateBlock<uint16_t>(address + sizeof(uint32_t) + _journalRecordSize, crc);
+		_journalBytesWritten += updateBlock<uint32_t>(address, seq);
+	}
+
+	_journalHead = slot;
+	_journalSeq = seq;
+	return true;
+}
+
+/**
+ * Returns true if the journal holds a valid record
+ */
+bool EEPROMClassEx::journalAvailable()
+{
+	return _journalHead >= 0;
+}
+
+/**
+ * Sequence number of the newest record, the number of records ever written
+ */
+uint32_t EEPROMClassEx::journalSequence()
+{
+	return _journalSeq;
+}
+
+/**
+ * Number of record slots in the journal region
+ */
+int EEPROMClassEx::journalSlots()
+{
+	return _journalSlots;
+}
+
+/**
+ * Number of times the journal has gone round its region, which is the
+ * number of erase/write cycles each slot has seen
+ */
+uint32_t EEPROMClassEx::journalCycles()
+{
+	if (_journalSlots == 0) return 0;
+	return (_journalSeq + _journalSlots - 1) / _journalSlots;
+}
+
+/**
+ * Bytes physically written by blocking journal writes since power up,
+ * queued writes are counted by queueBytesWritten()
+ */
+uint16_t EEPROMClassEx::journalBytesWritten()
+{
+	return _journalBytesWritten;
+}
+
+int EEPROMClassEx::journalSlotAddress(int slot)
+{
+	return _journalBase + slot * (_journalRecordSize + JOURNAL_SLOT_OVERHEAD);
+}
+
+/**
+ * CRC of the sequence number and record stored in a slot
+ */
+uint16_t EEPROMClassEx::journalCrc(int slot, uint32_t seq)
+{
+	uint16_t crc = 0xFFFF;
+	int address = journalSlotAddress(slot) + sizeof(uint32_t);
+	for (uint8_t i = 0; i < sizeof(seq); i++) {
+		crc = _crc16_update(crc, (uint8_t)(seq >> (8 * i)));
+	}
+	for (int i = 0; i < _journalRecordSize; i++) {
+		crc = _crc16_update(crc, readByte(address + i));
+	}
+	return crc;
+}
+
+/**
+ * CRC of a sequence number and a record in RAM
+ */
+uint16_t EEPROMClassEx::journalCrc(const void *data, uint32_t seq)
+{
+	uint16_t crc = 0xFFFF;
+	const byte* bytePointer = (const byte*)data;
+	for (uint8_t i = 0; i < sizeof(seq); i++) {
+		crc = _crc16_update(crc, (uint8_t)(seq >> (8 * i)));
+	}
+	for (int i = 0; i < _journalRecordSize; i++) {
+		crc = _crc16_update(crc, bytePointer[i]);
+	}
+	return crc;
+}
+
 /**
  * Performs check to see if writing to a memory address is allowed
  */
@@ -355,5 +671,10 @@ int EEPROMClassEx::_base= 0;
 int EEPROMClassEx::_memSize= 512;
 int EEPROMClassEx::_nextAvailableaddress= 0;
 int EEPROMClassEx::_writeCounts =0;
+EEPROMWrite EEPROMClassEx::_queue[EEPROM_QUEUE_SIZE];
+volatile uint8_t EEPROMClassEx::_queueHead = 0;
+volatile uint8_t EEPROMClassEx::_queueTail = 0;
+volatile uint16_t EEPROMClassEx::_queueBytesWritten = 0;
+void (*EEPROMClassEx::_queueCallback)() = NULL;
 
 EEPROMClassEx EEPROM;
@@ -27,6 +27,7 @@
 #endif
 #include <inttypes.h>
 #include <avr/eeprom.h>
+#include <util/crc16.h>
 
 
 #define EEPROMSizeATmega168   512     
@@ -57,6 +58,15 @@
 #define EEPROMSizeTeensy2pp   EEPROMSizeAT90USB1286
 #define EEPROMSizeTeensy3     EEPROMSizeMK20DX128
 #define EEPROMSizeTeensy31    EEPROMSizeMK20DX256
+
+#define EEPROM_QUEUE_SIZE     40      // pending writes for the EE_READY interrupt
+
+struct EEPROMWrite
+{
+	uint16_t address;
+	uint8_t  value;
+};
+
 class EEPROMClassEx
 {
 	  
@@ -92,6 +102,25 @@ class EEPROMClassEx
 	bool 	 updateFloat(int, float);
 	bool 	 updateDouble(int, double);
 
+	// Non-blocking writes, drained by the EE_READY interrupt
+	bool 	 queueUpdate(int, uint8_t);
+	bool 	 queueIdle();
+	uint8_t  queueFree();
+	void 	 flush();
+	void 	 setQueueCallback(void (*callback)());
+	uint16_t queueBytesWritten();
+	static void queueService();
+
+	// Wear levelled journal of fixed size records
+	bool 	 journalBegin(int base, int memSize, int recordSize);
+	bool 	 journalRead(void *data);
+	bool 	 journalWrite(const void *data, bool queued = false);
+	bool 	 journalAvailable();
+	uint32_t journalSequence();
+	int 	 journalSlots();
+	uint32_t journalCycles();
+	uint16_t journalBytesWritten();
+
 	
     // Use template for other data formats
 
@@ -111,7 +140,9 @@ class EEPROMClassEx
 	 */	
 	template <class T> int readBlock(int address, const T& value)
 	{		
+		uint8_t queue = queuePause();
 		eeprom_read_block((void*)&value, (const void*)address, sizeof(value));
+		queueResume(queue);
 		return sizeof(value);
 	}
 	
@@ -133,6 +164,7 @@ class EEPROMClassEx
 	template <class T> int writeBlock(int address, const T& value)
 	{
 		if (!isWriteOk(address+sizeof(value))) return 0;
+		flush();
 		eeprom_write_block((void*)&value, (void*)address, sizeof(value));			  			  
 		return sizeof(value);
 	}
@@ -170,8 +202,39 @@ class EEPROMClassEx
 		}
 		return writeCount;
 	}
-	
-	
+
+	/**
+	 * Template function to queue an update of any type of variable, such as structs
+	 * Bytes are compared and written from the EE_READY interrupt, so this returns
+	 * immediately. Returns the number of bytes queued, 0 if the queue was too full
+	 */
+	template <class T> int queueUpdateBlock(int address, const T& value)
+	{
+		if (queueFree() < (unsigned int)sizeof(value)) return 0;
+		const byte* bytePointer = (const byte*)(const void*)&value;
+		for (unsigned int i = 0; i < (unsigned int)sizeof(value); i++) {
+			queueUpdate(address + i, bytePointer[i]);
+		}
+		return sizeof(value);
+	}
+
+	/**
+	 * Template function to read the newest journal record into any type of variable
+	 */
+	template <class T> bool journalReadBlock(T& value)
+	{
+		if (sizeof(value) != (unsigned int)_journalRecordSize) return false;
+		return journalRead((void*)&value);
+	}
+
+	/**
+	 * Template function to append any type of variable to the journal
+	 */
+	template <class T> bool journalWriteBlock(const T& value, bool queued = false)
+	{
+		if (sizeof(value) != (unsigned int)_journalRecordSize) return false;
+		return journalWrite((const void*)&value, queued);
+	}
 	
 private:
 	//Private variables
@@ -183,6 +246,25 @@ private:
 	bool checkWrite(int base,int noOfBytes);	
 	bool isWriteOk(int address);
 	bool isReadOk(int address);
+	uint8_t queuePause();
+	void queueResume(uint8_t);
+	static bool queueStep();
+
+	static EEPROMWrite _queue[EEPROM_QUEUE_SIZE];
+	static volatile uint8_t _queueHead;
+	static volatile uint8_t _queueTail;
+	static volatile uint16_t _queueBytesWritten;
+	static void (*_queueCallback)();
+
+	int 	 _journalBase;
+	int 	 _journalSlots;
+	int 	 _journalRecordSize;
+	int 	 _journalHead;
+	uint32_t _journalSeq;
+	uint16_t _journalBytesWritten;
+	int 	 journalSlotAddress(int slot);
+	uint16_t journalCrc(int slot, uint32_t seq);
+	uint16_t journalCrc(const void *data, uint32_t seq);
 };
 
 extern EEPROMClassEx EEPROM;
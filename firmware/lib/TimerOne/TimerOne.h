@@ -110,6 +110,23 @@ class TimerOne
 	else if (pin == TIMER1_C_PIN) OCR1C = dutyCycle;
 	#endif
     }
+    // Same as setPwmDuty() but with a 16 bit duty, so periods longer than
+    // 1024 timer counts get their full resolution
+    void setPwmDuty16(char pin, unsigned int duty) __attribute__((always_inline)) {
+	unsigned long dutyCycle = pwmPeriod;
+	dutyCycle *= duty;
+	dutyCycle >>= 16;
+	if (pin == TIMER1_A_PIN) OCR1A = dutyCycle;
+	#ifdef TIMER1_B_PIN
+	else if (pin == TIMER1_B_PIN) OCR1B = dutyCycle;
+	#endif
+	#ifdef TIMER1_C_PIN
+	else if (pin == TIMER1_C_PIN) OCR1C = dutyCycle;
+	#endif
+    }
+    unsigned int getPwmPeriod() __attribute__((always_inline)) {
+	return pwmPeriod;
+    }
     void pwm(char pin, unsigned int duty) __attribute__((always_inline)) {
 	if (pin == TIMER1_A_PIN) { pinMode(TIMER1_A_PIN, OUTPUT); TCCR1A |= _BV(COM1A1); }
 	#ifdef TIMER1_B_PIN
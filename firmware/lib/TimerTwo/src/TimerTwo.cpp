@@ -0,0 +1,117 @@
+/**
+ * @file    TimerTwo.cpp
+ * @brief   Periodic interrupt on the 8 bit Timer2 of the ATmega168/328
+ *
+ * Runs Timer2 in CTC mode so its period is independent of Timer1, which is
+ * left free for PWM. The interface follows TimerOne so the two can be used
+ * side by side. Periods from a few microseconds up to 1024 * 256 clock
+ * cycles (32.7 ms at 8 MHz) are supported.
+ */
+
+#include <Arduino.h>
+#include <avr/interrupt.h>
+
+#include "TimerTwo.h"
+
+TimerTwo Timer2;
+
+unsigned char TimerTwo::clockSelectBits = 0;
+unsigned long TimerTwo::periodMicros = 0;
+void (*TimerTwo::isrCallback)() = TimerTwo::isrDefaultUnused;
+
+/**
+ * @brief Stops the timer, selects CTC mode and sets the period
+ */
+void TimerTwo::initialize(unsigned long microseconds)
+{
+  TCCR2B = 0;
+  TCCR2A = _BV(WGM21);
+  TCNT2 = 0;
+  setPeriod(microseconds);
+}
+
+/**
+ * @brief Picks the smallest prescaler that fits the period into 8 bits
+ */
+void TimerTwo::setPeriod(unsigned long microseconds)
+{
+  const unsigned long cycles = (F_CPU / 1000000) * microseconds;
+  unsigned long counts;
+
+  if (cycles < TIMER2_RESOLUTION) {
+    clockSelectBits = _BV(CS20);
+    counts = cycles;
+  } else if (cycles < TIMER2_RESOLUTION * 8) {
+    clockSelectBits = _BV(CS21);
+    counts = cycles / 8;
+  } else if (cycles < TIMER2_RESOLUTION * 32) {
+    clockSelectBits = _BV(CS21) | _BV(CS20);
+    counts = cycles / 32;
+  } else if (cycles < TIMER2_RESOLUTION * 64) {
+    clockSelectBits = _BV(CS22);
+    counts = cycles / 64;
+  } else if (cycles < TIMER2_RESOLUTION * 128) {
+    clockSelectBits = _BV(CS22) | _BV(CS20);
+    counts = cycles / 128;
+  } else if (cycles < TIMER2_RESOLUTION * 256) {
+    clockSelectBits = _BV(CS22) | _BV(CS21);
+    counts = cycles / 256;
+  } else if (cycles < TIMER2_RESOLUTION * 1024) {
+    clockSelectBits = _BV(CS22) | _BV(CS21) | _BV(CS20);
+    counts = cycles / 1024;
+  } else {
+    clockSelectBits = _BV(CS22) | _BV(CS21) | _BV(CS20);
+    counts = TIMER2_RESOLUTION;
+  }
+  if (counts == 0) {
+    counts = 1;
+  }
+  periodMicros = microseconds;
+  OCR2A = (uint8_t)(counts - 1);
+  TCCR2B = clockSelectBits;
+}
+
+/**
+ * @brief Returns the period last passed to initialize() or setPeriod()
+ */
+unsigned long TimerTwo::period()
+{
+  return periodMicros;
+}
+
+void TimerTwo::start()
+{
+  TCCR2B = 0;
+  TCNT2 = 0;
+  TCCR2B = clockSelectBits;
+}
+
+void TimerTwo::stop()
+{
+  TCCR2B = 0;
+}
+
+void TimerTwo::attachInterrupt(void (*isr)())
+{
+  isrCallback = isr;
+  TIFR2 = _BV(OCF2A);
+  TIMSK2 = _BV(OCIE2A);
+}
+
+void TimerTwo::detachInterrupt()
+{
+  TIMSK2 = 0;
+}
+
+/*******************************************************************************
+ * Interrupt Service Routine
+ ******************************************************************************/
+
+ISR(TIMER2_COMPA_vect)
+{
+  Timer2.isrCallback();
+}
+
+void TimerTwo::isrDefaultUnused()
+{
+}
@@ -0,0 +1,34 @@
+#ifndef TIMERTWO_H
+#define TIMERTWO_H
+
+#include <Arduino.h>
+
+#define TIMER2_RESOLUTION 256UL  // Timer2 is 8 bit
+
+/* TimerTwo Class */
+class TimerTwo {
+public:
+    //Configuration
+    void initialize(unsigned long microseconds = 1000);
+    void setPeriod(unsigned long microseconds);
+    unsigned long period();
+
+    //Run Control
+    void start();
+    void stop();
+
+    //Interrupt Function
+    void attachInterrupt(void (*isr)());
+    void detachInterrupt();
+
+    static void (*isrCallback)();
+    static void isrDefaultUnused();
+
+private:
+    static unsigned char clockSelectBits;
+    static unsigned long periodMicros;
+};
+
+extern TimerTwo Timer2;
+
+#endif
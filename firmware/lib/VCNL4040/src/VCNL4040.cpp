@@ -22,7 +22,15 @@
  */
 VCNL4040::VCNL4040()
 {
-
+  _shadowValid = 0;
+  _writesSkipped = 0;
+  _alsRange = 1;
+  _alsAuto = false;
+  _alsSettling = false;
+  _alsSwitched = 0;
+  _alsMilliLux = 0;
+  _alsCounts = 0;
+  _whiteCounts = 0;
 }
 
 /**
@@ -43,6 +51,7 @@ bool VCNL4040::init()
     uint8_t id;
     /* Initialize I2C */
     Wire.begin();
+    invalidate();
     /* Read ID register and check against known values for VCNL4040 */
     if( !wireRead8(VCNL4040_ID_L, id) ) {
         return false;
@@ -53,10 +62,26 @@ bool VCNL4040::init()
 //Settings
 bool VCNL4040::alsConf(uint8_t conf)
 {
-  if(!wireWrite8(VCNL4040_ALS_CONF, conf))
+  if(!writeReg(VCNL4040_ALS_CONF, conf))
   {
     return false;
   }
+  _alsRange = (conf & VCNL4040_ALS_IT_MASK) >> VCNL4040_ALS_IT_SHIFT;
+  return true;
+}
+
+bool VCNL4040::alsSetIntThres(uint16_t high, uint16_t low)
+{
+  if(!writeReg(VCNL4040_ALS_THDH, high))
+  {
+    return false;
+  }
+
+  if(!writeReg(VCNL4040_ALS_THDL, low))
+  {
+    return false;
+  }
+
   return true;
 }
 
@@ -67,7 +92,134 @@ uint16_t VCNL4040::lux(void)
   {
     return -1;
   }
-  return counts/20;
+  return alsMilliLux(counts)/1000;
+}
+
+/**
+ * @brief Scales ALS counts for the current integration time. A count is
+ * 100 mlux at 80 ms and halves with each doubling of the integration time.
+ */
+uint32_t VCNL4040::alsMilliLux(uint16_t counts)
+{
+  return ((uint32_t)counts * 100) >> _alsRange;
+}
+
+/**
+ * @brief Reads the ALS in mlux. With autoranging on, the integration time
+ * for the next reading is then shortened near saturation and lengthened in
+ * the dark. Until a full cycle has run at a new integration time the last
+ * value is returned, as the data register still holds the old scale.
+ *
+ * @return False on a bus error.
+ */
+bool VCNL4040::alsRead(uint32_t &milliLux)
+{
+  uint16_t white;
+  return alsRead(milliLux, white);
+}
+
+/**
+ * @brief As alsRead(), also returning the WHITE channel counts taken in the
+ * same pass and at the same integration time. Autoranging goes by the
+ * larger of the two, so WHITE does not clip either.
+ */
+bool VCNL4040::alsRead(uint32_t &milliLux, uint16_t &white)
+{
+  if (_alsSettling)
+  {
+    if ((millis() - _alsSwitched) < ((uint32_t)160 << _alsRange)) {
+      milliLux = _alsMilliLux;
+      white = _whiteCounts;
+      return true;
+    }
+    _alsSettling = false;
+  }
+  uint16_t counts;
+  if(!alsWhiteCounts(counts, _whiteCounts))
+  {
+    return false;
+  }
+  _alsCounts = counts;
+  _alsMilliLux = alsMilliLux(counts);
+  milliLux = _alsMilliLux;
+  white = _whiteCounts;
+  if (_alsAuto)
+  {
+    uint16_t peak = (_whiteCounts > counts) ? _whiteCounts : counts;
+    if (peak > VCNL4040_ALS_RANGE_UP && _alsRange > 0) {
+      alsSetRange(_alsRange - 1);
+    }
+    else if (peak < VCNL4040_ALS_RANGE_DOWN && _alsRange < VCNL4040_ALS_RANGES - 1) {
+      alsSetRange(_alsRange + 1);
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Sets the ALS integration time, 0 to 3 for 80 to 640 ms
+ */
+bool VCNL4040::alsSetRange(uint8_t range)
+{
+  if (range >= VCNL4040_ALS_RANGES) {
+    return false;
+  }
+  if(!updateReg(VCNL4040_ALS_CONF, VCNL4040_ALS_IT_MASK, (uint16_t)range << VCNL4040_ALS_IT_SHIFT))
+  {
+    return false;
+  }
+  if (range != _alsRange) {
+    _alsRange = range;
+    _alsSwitched = millis();
+    _alsSettling = true;
+  }
+  return true;
+}
+
+uint8_t VCNL4040::alsRange(void)
+{
+  return _alsRange;
+}
+
+void VCNL4040::alsSetAuto(bool enable)
+{
+  _alsAuto = enable;
+}
+
+/**
+ * @brief Reads ALS_DATA and WHITE_DATA back to back. The device has no
+ * register auto increment, so these are two word reads with nothing
+ * else on the bus in between.
+ */
+bool VCNL4040::alsWhiteCounts(uint16_t &als, uint16_t &white)
+{
+  if(!wireRead16(VCNL4040_ALS_DATA, als))
+  {
+    return false;
+  }
+  if(!wireRead16(VCNL4040_WHITE_DATA, white))
+  {
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief WHITE over ALS counts from the last alsRead(), in 1/1000. Light
+ * with a lot of infrared, such as daylight or incandescent, gives a higher
+ * ratio than most LED and fluorescent lighting. 0xFFFF when there is no
+ * ratio to give: either channel clipped, or WHITE with no ALS counts.
+ */
+uint16_t VCNL4040::whiteRatio(void)
+{
+  if (_alsCounts == 0xFFFF || _whiteCounts == 0xFFFF) {
+    return 0xFFFF;
+  }
+  if (_alsCounts == 0) {
+    return (_whiteCounts == 0) ? 0 : 0xFFFF;
+  }
+  uint32_t ratio = ((uint32_t)_whiteCounts * 1000) / _alsCounts;
+  return (ratio > 0xFFFF) ? 0xFFFF : ratio;
 }
 
 bool VCNL4040::psConf(uint8_t conf1, uint8_t conf2, uint8_t conf3, uint8_t ms)
@@ -78,12 +230,12 @@ bool VCNL4040::psConf(uint8_t conf1, uint8_t conf2, uint8_t conf3, uint8_t ms)
   uint16_t confReg2 = ms;
   confReg2 = (confReg2 << 8) + conf3;
 
-  if(!wireWrite16(VCNL4040_PS_CONF_1_2, confReg1))
+  if(!writeReg(VCNL4040_PS_CONF_1_2, confReg1))
   {
     return false;
   }
 
-  if(!wireWrite16(VCNL4040_PS_CONF_3_MS, confReg2))
+  if(!writeReg(VCNL4040_PS_CONF_3_MS, confReg2))
   {
     return false;
   }
@@ -93,7 +245,7 @@ bool VCNL4040::psConf(uint8_t conf1, uint8_t conf2, uint8_t conf3, uint8_t ms)
 uint16_t VCNL4040::psIdle()
 {
   uint32_t tally=0;
-  for (uint8_t i=0; i<15; i++){
+  for (uint8_t i=0; i<16; i++){
     tally+=ps();
   }
 
@@ -113,7 +265,7 @@ uint16_t VCNL4040::psCalibrate()
 
 bool VCNL4040::psSetCanc(uint16_t level)
 {
-  if(!wireWrite16(VCNL4040_PS_CANC, level))
+  if(!writeReg(VCNL4040_PS_CANC, level))
   {
     return false;
   }
@@ -122,18 +274,41 @@ bool VCNL4040::psSetCanc(uint16_t level)
 
 bool VCNL4040::psSetIntThres(uint16_t high, uint16_t low)
 {
-  if(!wireWrite16(VCNL4040_PS_THDH, high))
+  if(!writeReg(VCNL4040_PS_THDH, high))
   {
     return false;
   }
 
-  if(!wireWrite16(VCNL4040_PS_THDL, low))
+  if(!writeReg(VCNL4040_PS_THDL, low))
   {
     return false;
   }
 
   return true;
 }
+/**
+ * @brief Time between PS conversions in us, from the shadowed configuration.
+ * The LED is on for one integration time in each 40 to 320 of them.
+ *
+ * @return 0 in active force mode, or if the configuration cannot be read
+ */
+uint32_t VCNL4040::psPeriod(void)
+{
+  static const uint8_t itHalfT[8] = {2, 3, 4, 5, 6, 7, 8, 16};
+  uint16_t conf12;
+  uint16_t conf3;
+  if(!readReg(VCNL4040_PS_CONF_1_2, conf12) || !readReg(VCNL4040_PS_CONF_3_MS, conf3))
+  {
+    return 0;
+  }
+  if(conf3 & VCNL4040_PS_AF)
+  {
+    return 0;
+  }
+  uint32_t it = (uint32_t)itHalfT[(conf12 & VCNL4040_PS_IT_MASK) >> VCNL4040_PS_IT_SHIFT] * VCNL4040_PS_T_HALF_NS;
+  return it * (40 << ((conf12 & VCNL4040_PS_DUTY_MASK) >> VCNL4040_PS_DUTY_SHIFT)) / 1000;
+}
+
 uint16_t VCNL4040::ps(void)
 {
   uint16_t ps;
@@ -144,6 +319,16 @@ uint16_t VCNL4040::ps(void)
   return ps;
 }
 
+uint16_t VCNL4040::white(void)
+{
+  uint16_t white;
+  if(!wireRead16(VCNL4040_WHITE_DATA, white))
+  {
+    return -1;
+  }
+  return white;
+}
+
 uint16_t VCNL4040::intFlag(void)
 {
   uint16_t intF;
@@ -165,6 +350,110 @@ uint8_t VCNL4040::id(void)
   return id;
 }
 
+/*******************************************************************************
+ * Register shadow
+ *
+ * The driver keeps a copy of every writable register. A write that would not
+ * change the register is skipped, and fields are changed from the copy without
+ * reading the bus. A failed write drops the copy of that register so the next
+ * write goes out regardless.
+ ******************************************************************************/
+
+/**
+ * @brief Writes a register unless the shadow shows it already holds val
+ *
+ * @return True if the register holds val. False on a bus error.
+ */
+bool VCNL4040::writeReg(uint8_t reg, uint16_t val)
+{
+  if (reg >= VCNL4040_SHADOW_REGS) {
+    return wireWrite16(reg, val);
+  }
+  if ((_shadowValid & (1 << reg)) && _shadow[reg] == val) {
+    _writesSkipped++;
+    return true;
+  }
+  if (!wireWrite16(reg, val)) {
+    _shadowValid &= ~(1 << reg);
+    return false;
+  }
+  _shadow[reg] = val;
+  _shadowValid |= (1 << reg);
+  return true;
+}
+
+/**
+ * @brief Replaces the bits of a register selected by mask
+ */
+bool VCNL4040::updateReg(uint8_t reg, uint16_t mask, uint16_t val)
+{
+  uint16_t current;
+  if (!readReg(reg, current)) {
+    return false;
+  }
+  return writeReg(reg, (current & ~mask) | (val & mask));
+}
+
+/**
+ * @brief Reads a register from the shadow, or from the bus if it has no copy
+ */
+bool VCNL4040::readReg(uint8_t reg, uint16_t &val)
+{
+  if (reg < VCNL4040_SHADOW_REGS && (_shadowValid & (1 << reg))) {
+    val = _shadow[reg];
+    return true;
+  }
+  if (!wireRead16(reg, val)) {
+    return false;
+  }
+  if (reg < VCNL4040_SHADOW_REGS) {
+    _shadow[reg] = val;
+    _shadowValid |= (1 << reg);
+  }
+  return true;
+}
+
+/**
+ * @brief Reads back every shadowed register and takes the device's value
+ *
+ * @param mismatch set to a bit per register whose copy was missing or wrong
+ * @return True if every register could be read
+ */
+bool VCNL4040::verify(uint8_t &mismatch)
+{
+  bool ok = true;
+  mismatch = 0;
+  for (uint8_t reg = 0; reg < VCNL4040_SHADOW_REGS; reg++)
+  {
+    uint16_t val;
+    if (!wireRead16(reg, val)) {
+      _shadowValid &= ~(1 << reg);
+      mismatch |= (1 << reg);
+      ok = false;
+      continue;
+    }
+    if (!(_shadowValid & (1 << reg)) || _shadow[reg] != val) {
+      mismatch |= (1 << reg);
+    }
+    _shadow[reg] = val;
+    _shadowValid |= (1 << reg);
+  }
+  return ok;
+}
+
+/**
+ * @brief Forgets the shadow, e.g. after the sensor lost power
+ */
+void VCNL4040::invalidate()
+{
+  _shadowValid = 0;
+}
+
+uint16_t VCNL4040::writesSkipped()
+{
+  return _writesSkipped;
+}
+
 /*******************************************************************************
  * Raw I2C Reads and Writes
  ******************************************************************************/
@@ -22,6 +22,24 @@
 #define VCNL4040_INT_FLAG         0x0B
 #define VCNL4040_ID               0x0C
 
+// Writable registers 0x00 to 0x07 are shadowed
+#define VCNL4040_SHADOW_REGS      8
+
+// ALS integration time, range 0 to 3 is 80, 160, 320 and 640 ms
+#define VCNL4040_ALS_IT_MASK      0x00C0
+#define VCNL4040_ALS_IT_SHIFT     6
+#define VCNL4040_ALS_RANGES       4
+#define VCNL4040_ALS_RANGE_UP     0xE000  // shorten the integration above this count
+#define VCNL4040_ALS_RANGE_DOWN   0x2000  // lengthen it below this, well clear of RANGE_UP once doubled
+
+// PS integration time 1T to 8T in PS_CONF1 bits 3:1, LED duty 1/40 to 1/320 in bits 7:6
+#define VCNL4040_PS_IT_MASK       0x000E
+#define VCNL4040_PS_IT_SHIFT      1
+#define VCNL4040_PS_DUTY_MASK     0x00C0
+#define VCNL4040_PS_DUTY_SHIFT    6
+#define VCNL4040_PS_AF            0x0008  // PS_CONF3, active force mode
+#define VCNL4040_PS_T_HALF_NS     62500   // half of 1T
+
 /* VCNL4040 Class */
 class VCNL4040 {
 public:
@@ -34,11 +52,20 @@ public:
     bool alsConf(uint8_t conf);
     bool alsSetIntThres(uint16_t high, uint16_t low);
     uint16_t lux();
+    bool alsRead(uint32_t &milliLux);
+    bool alsRead(uint32_t &milliLux, uint16_t &white);
+    bool alsWhiteCounts(uint16_t &als, uint16_t &white);
+    uint16_t whiteRatio();
+    bool alsSetRange(uint8_t range);
+    uint8_t alsRange();
+    void alsSetAuto(bool enable);
+    uint32_t alsMilliLux(uint16_t counts);
 
     bool psConf(uint8_t conf1, uint8_t conf2, uint8_t conf3, uint8_t ms);
     uint16_t psCalibrate(void);
     bool psSetCanc(uint16_t level);
     bool psSetIntThres(uint16_t high, uint16_t low);
+    uint32_t psPeriod();
     uint16_t psIdle();
     uint16_t ps();
     uint16_t white();
@@ -46,12 +73,32 @@ public:
     uint16_t intFlag();
     uint8_t id();
 
+    //Register shadow
+    bool writeReg(uint8_t reg, uint16_t val);
+    bool updateReg(uint8_t reg, uint16_t mask, uint16_t val);
+    bool readReg(uint8_t reg, uint16_t &val);
+    bool verify(uint8_t &mismatch);
+    void invalidate();
+    uint16_t writesSkipped();
+
     //I2C Commands
     bool wireWrite8(uint8_t reg, uint8_t val);
     bool wireWrite16(uint8_t reg, uint16_t val);
     bool wireReadStart(uint8_t val);
     bool wireRead8(uint8_t reg, uint8_t &val);
     bool wireRead16(uint8_t reg, uint16_t &val);
+
+private:
+    uint16_t _shadow[VCNL4040_SHADOW_REGS];
+    uint8_t _shadowValid;
+    uint16_t _writesSkipped;
+    uint8_t _alsRange;
+    bool _alsAuto;
+    bool _alsSettling;
+    uint32_t _alsSwitched;
+    uint32_t _alsMilliLux;
+    uint16_t _alsCounts;
+    uint16_t _whiteCounts;
 };
 
 #endif
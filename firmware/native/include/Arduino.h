@@ -0,0 +1,95 @@
+/*
+ * Arduino.h - minimal Arduino core stand-in for the native (host) build
+ *
+ * Only the parts of the core used by the firmware and its libraries are
+ * provided. Hardware registers are plain variables (see avr/io.h) so that
+ * libraries taking their __AVR__ code paths compile unmodified.
+ */
+
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stddef.h>
+
+#include <avr/pgmspace.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#ifndef ARDUINO
+#define ARDUINO 10605
+#endif
+
+#ifndef F_CPU
+#define F_CPU 8000000UL
+#endif
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+#define LSBFIRST 0
+#define MSBFIRST 1
+
+#define CHANGE 1
+#define FALLING 2
+#define RISING 3
+
+typedef uint8_t byte;
+typedef bool boolean;
+typedef unsigned int word;
+
+template <class T, class U> static inline T min(T a, U b) { return (a < (T)b) ? a : (T)b; }
+template <class T, class U> static inline T max(T a, U b) { return (a > (T)b) ? a : (T)b; }
+#define constrain(amt,low,high) ((amt)<(low)?(low):((amt)>(high)?(high):(amt)))
+#define lowByte(w) ((uint8_t) ((w) & 0xff))
+#define highByte(w) ((uint8_t) ((w) >> 8))
+
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+void analogWrite(uint8_t pin, int val);
+void attachInterrupt(uint8_t interruptNum, void (*userFunc)(void), int mode);
+void detachInterrupt(uint8_t interruptNum);
+
+// avr-libc provides strlcpy, glibc only does from 2.38 on
+#if defined(__GLIBC__) && !__GLIBC_PREREQ(2, 38)
+static inline size_t strlcpy(char *dst, const char *src, size_t size)
+{
+	size_t length = strlen(src);
+	if (size) {
+		size_t n = (length >= size) ? size - 1 : length;
+		memcpy(dst, src, n);
+		dst[n] = '\0';
+	}
+	return length;
+}
+#endif
+
+#define digitalPinToInterrupt(p) ((p) == 2 ? 0 : ((p) == 3 ? 1 : -1))
+
+#include "Print.h"
+#include "Stream.h"
+#include "HardwareSerial.h"
+
+void setup(void);
+void loop(void);
+
+#endif
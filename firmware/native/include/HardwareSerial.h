@@ -0,0 +1,58 @@
+/*
+ * HardwareSerial.h - host-side Serial for the native build
+ *
+ * Received bytes are queued with inject(), or read from a file descriptor
+ * set with setInput() each time nativeService() runs. Everything the
+ * firmware writes is appended to a transcript that the host harness can
+ * drain with take(), and copied to the descriptor set with setEcho().
+ */
+
+#ifndef HardwareSerial_h
+#define HardwareSerial_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include "Stream.h"
+
+#define SERIAL_NATIVE_BUFFER_SIZE 4096
+
+class HardwareSerial : public Stream
+{
+public:
+	HardwareSerial();
+	void begin(unsigned long baud);
+	void end();
+	unsigned long baud() const { return _baud; }
+
+	int available();
+	int read();
+	int peek();
+	size_t write(uint8_t);
+	using Print::write;
+	operator bool() { return true; }
+
+	// host side
+	size_t inject(const char *data, size_t length);
+	size_t inject(const char *data);
+	size_t take(char *buffer, size_t size);
+	size_t pending() const { return _txCount; }
+	void setEcho(int fd) { _echoFd = fd; }
+	void setInput(int fd) { _inputFd = fd; }
+	void setCapture(bool capture) { _capture = capture; }
+	void poll();
+
+private:
+	unsigned long _baud;
+	uint8_t _rx[SERIAL_NATIVE_BUFFER_SIZE];
+	size_t _rxHead;
+	size_t _rxTail;
+	char _tx[SERIAL_NATIVE_BUFFER_SIZE];
+	size_t _txCount;
+	int _echoFd;
+	int _inputFd;
+	bool _capture;
+};
+
+extern HardwareSerial Serial;
+
+#endif
@@ -0,0 +1,69 @@
+/*
+ * NativeHost.h - host side controls for the native build
+ *
+ * The firmware itself only sees the Arduino stand-ins. A harness (the host
+ * main in native/src/host.cpp, or a test) uses these calls to drive the
+ * clock, deliver interrupts and look at what the firmware did.
+ */
+
+#ifndef _NATIVE_HOST_H_
+#define _NATIVE_HOST_H_
+
+#include <stdint.h>
+
+#define NATIVE_EEPROM_SIZE			1024
+#define NATIVE_EEPROM_WRITE_US	3400		// one byte, as on the ATmega328P
+#define NATIVE_PINS							20
+
+// Vectors the timer emulation delivers, see nativeInterrupts()
+#define NATIVE_VECT_TIMER1_OVF	0
+#define NATIVE_VECT_TIMER2_COMPA	1
+#define NATIVE_VECT_EE_READY		2
+#define NATIVE_VECT_INT0				3
+#define NATIVE_VECT_INT1				4
+#define NATIVE_VECTORS					5
+
+// Clock, in microseconds since start up. It follows the host's monotonic
+// clock unless nativeUseVirtualClock() is called before setup(), after
+// which it only moves when the harness advances it or the firmware waits.
+uint64_t nativeMicros(void);
+void nativeUseVirtualClock(void);
+bool nativeVirtualClock(void);
+// Virtual clock only: move the clock on, running each interrupt at the
+// time it falls due. Costs such as I2C transfers and delay() use these.
+void nativeAdvance(uint64_t us);
+void nativeAdvanceTo(uint64_t us);
+// Time of the next enabled timer interrupt or EEPROM write completion
+uint64_t nativeNextEvent(void);
+// The firmware is spinning until something changes. Services interrupts
+// on the host clock; on the virtual clock skips ahead to the next event.
+void nativeWait(void);
+// Goes up whenever an interrupt runs or there is I2C, serial or EEPROM
+// traffic, so a harness can tell a pass of loop() that did nothing.
+uint32_t nativeActivity(void);
+void nativeActive(void);
+
+// Bring the timers and the EEPROM up to the current time and run every
+// interrupt that has come due, in time order. Called between passes of
+// loop() and while delay() waits.
+void nativeService(void);
+uint32_t nativeInterrupts(uint8_t vector);
+
+// EEPROM image, erased to 0xFF unless SENSORHUB_EEPROM names a file
+uint8_t *nativeEeprom(void);
+uint32_t nativeEepromWrites(void);
+bool nativeEepromBusy(void);
+uint64_t nativeEepromReadyAt(void);
+
+// last mode and level set on each pin
+uint8_t nativePinMode(uint8_t pin);
+uint8_t nativePinLevel(uint8_t pin);
+// Drive an input from outside, as a device output wired to the pin would.
+// digitalRead() then returns the level, and on pins 2 and 3 an edge that
+// matches attachInterrupt() raises INT0 or INT1.
+void nativeDrivePin(uint8_t pin, uint8_t level);
+
+// run setup() and then loop() for good; the host main calls this
+void nativeRun(void) __attribute__((noreturn));
+
+#endif
@@ -0,0 +1,34 @@
+/*
+ * SPI.h - SPI stand-in for the native build
+ *
+ * The sensors on the SensorHub are wired to I2C; SPI is only referenced by
+ * the BME280 driver and always reads back 0xFF.
+ */
+
+#ifndef _NATIVE_SPI_H_
+#define _NATIVE_SPI_H_
+
+#include <Arduino.h>
+
+#define SPI_CLOCK_DIV4 0x00
+#define SPI_CLOCK_DIV16 0x01
+#define SPI_CLOCK_DIV32 0x06
+#define SPI_MODE0 0x00
+#define SPI_MODE1 0x04
+#define SPI_MODE2 0x08
+#define SPI_MODE3 0x0C
+
+class SPIClass
+{
+public:
+	void begin() {}
+	void end() {}
+	void setClockDivider(uint8_t) {}
+	void setBitOrder(uint8_t) {}
+	void setDataMode(uint8_t) {}
+	uint8_t transfer(uint8_t) { return 0xFF; }
+};
+
+extern SPIClass SPI;
+
+#endif
@@ -0,0 +1,88 @@
+/*
+ * Wire.h - I2C stand-in for the native build
+ *
+ * Transactions are routed to I2CDevice objects attached by address. With no
+ * device attached at an address the bus NACKs, just like an empty socket.
+ * On the virtual clock each transaction takes the time its bytes need at
+ * the bus clock, 9 bit times per byte including the address.
+ *
+ * setStuck() holds the bus the way a slave stuck driving SDA low does, and
+ * every transaction fails with error 4. The AVR TwoWire of this era has no
+ * timeout and would hang for good instead; failing keeps a run going so
+ * the firmware's handling of bus errors can be looked at.
+ */
+
+#ifndef _NATIVE_WIRE_H_
+#define _NATIVE_WIRE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "Stream.h"
+
+#define BUFFER_LENGTH 32
+#define WIRE_MAX_DEVICES 4
+
+class I2CDevice
+{
+public:
+	virtual ~I2CDevice() {}
+	// Called with the bytes of one write transaction. Return false to NACK.
+	virtual bool i2cWrite(const uint8_t *data, uint8_t length) = 0;
+	// Fill up to length bytes for a read transaction, return the count sent.
+	virtual uint8_t i2cRead(uint8_t *data, uint8_t length) = 0;
+};
+
+class TwoWire : public Stream
+{
+public:
+	TwoWire();
+	void begin();
+	void begin(uint8_t address) { (void)address; begin(); }
+	void setClock(uint32_t clock) { _clock = clock; }
+
+	void beginTransmission(uint8_t address);
+	void beginTransmission(int address) { beginTransmission((uint8_t)address); }
+	uint8_t endTransmission(void) { return endTransmission(true); }
+	uint8_t endTransmission(uint8_t sendStop);
+	uint8_t requestFrom(uint8_t address, uint8_t quantity);
+	uint8_t requestFrom(int address, int quantity) { return requestFrom((uint8_t)address, (uint8_t)quantity); }
+
+	size_t write(uint8_t);
+	size_t write(const uint8_t *data, size_t quantity);
+	using Print::write;
+	int available(void);
+	int read(void);
+	int peek(void);
+
+	// host side
+	bool attach(uint8_t address, I2CDevice *device);
+	void detach(uint8_t address);
+	void setStuck(bool stuck) { _stuck = stuck; }
+	bool stuck() const { return _stuck; }
+	// every transaction started, and those NACKed or lost to a stuck bus
+	uint32_t transactions() const { return _transactions; }
+	uint32_t errors() const { return _errors; }
+	void resetTransactions() { _transactions = 0; _errors = 0; }
+
+private:
+	I2CDevice *find(uint8_t address);
+	void transfer(uint8_t bytes);
+
+	uint8_t _addresses[WIRE_MAX_DEVICES];
+	I2CDevice *_devices[WIRE_MAX_DEVICES];
+	uint8_t _txAddress;
+	uint8_t _txBuffer[BUFFER_LENGTH];
+	uint8_t _txLength;
+	bool _transmitting;
+	uint8_t _rxBuffer[BUFFER_LENGTH];
+	uint8_t _rxIndex;
+	uint8_t _rxLength;
+	uint32_t _transactions;
+	uint32_t _errors;
+	uint32_t _clock;
+	bool _stuck;
+};
+
+extern TwoWire Wire;
+
+#endif
@@ -0,0 +1,32 @@
+/*
+ * avr/eeprom.h - EEPROM stand-in for the native build
+ *
+ * Backed by a 1 KB array that is loaded from and flushed to the file named
+ * by the SENSORHUB_EEPROM environment variable (see native/src/eeprom.cpp).
+ * Pointers are taken as void * because avr-libc's uint32_t is unsigned long,
+ * which is a different type on the host.
+ */
+
+#ifndef _NATIVE_AVR_EEPROM_H_
+#define _NATIVE_AVR_EEPROM_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+int eeprom_is_ready(void);
+void nativeWait(void);
+#define eeprom_busy_wait() do { while (!eeprom_is_ready()) nativeWait(); } while (0)
+
+uint8_t eeprom_read_byte(const void *p);
+uint16_t eeprom_read_word(const void *p);
+uint32_t eeprom_read_dword(const void *p);
+void eeprom_read_block(void *dst, const void *src, size_t n);
+
+void eeprom_write_byte(void *p, uint8_t value);
+void eeprom_write_word(void *p, uint16_t value);
+void eeprom_write_dword(void *p, uint32_t value);
+void eeprom_write_block(const void *src, void *dst, size_t n);
+
+void eeprom_update_byte(void *p, uint8_t value);
+
+#endif
@@ -0,0 +1,18 @@
+/*
+ * avr/interrupt.h - interrupt vector stand-in for the native build
+ *
+ * ISR(vector) defines an ordinary extern "C" function named after the
+ * vector, which the host harness calls to deliver the interrupt.
+ */
+
+#ifndef _NATIVE_AVR_INTERRUPT_H_
+#define _NATIVE_AVR_INTERRUPT_H_
+
+#include <avr/io.h>
+
+#define ISR(vector, ...) extern "C" void vector(void); extern "C" void vector(void)
+
+#define sei() (SREG |= 0x80)
+#define cli() (SREG &= (uint8_t)~0x80)
+
+#endif
@@ -0,0 +1,106 @@
+/*
+ * avr/io.h - ATmega328P register file stand-in for the native build
+ *
+ * Registers are ordinary variables defined in native/src/registers.cpp.
+ * The timer emulation reads them to work out interrupt periods, and a
+ * harness can read them to see PWM duty cycles and timer configuration.
+ */
+
+#ifndef _NATIVE_AVR_IO_H_
+#define _NATIVE_AVR_IO_H_
+
+#include <stdint.h>
+
+#ifndef __AVR__
+#define __AVR__
+#endif
+#ifndef __AVR_ATmega328P__
+#define __AVR_ATmega328P__
+#endif
+
+#define _BV(bit) (1 << (bit))
+
+#define NATIVE_REG8(name) extern volatile uint8_t name
+#define NATIVE_REG16(name) extern volatile uint16_t name
+
+NATIVE_REG8(SREG);
+NATIVE_REG8(MCUSR);
+
+// Timer/Counter0
+NATIVE_REG8(TCCR0A);
+NATIVE_REG8(TCCR0B);
+NATIVE_REG8(TCNT0);
+NATIVE_REG8(OCR0A);
+NATIVE_REG8(OCR0B);
+NATIVE_REG8(TIMSK0);
+NATIVE_REG8(TIFR0);
+
+// Timer/Counter1
+NATIVE_REG8(TCCR1A);
+NATIVE_REG8(TCCR1B);
+NATIVE_REG8(TCCR1C);
+NATIVE_REG16(TCNT1);
+NATIVE_REG16(ICR1);
+NATIVE_REG16(OCR1A);
+NATIVE_REG16(OCR1B);
+NATIVE_REG8(TIMSK1);
+NATIVE_REG8(TIFR1);
+
+// Timer/Counter2
+NATIVE_REG8(TCCR2A);
+NATIVE_REG8(TCCR2B);
+NATIVE_REG8(TCNT2);
+NATIVE_REG8(OCR2A);
+NATIVE_REG8(OCR2B);
+NATIVE_REG8(TIMSK2);
+NATIVE_REG8(TIFR2);
+NATIVE_REG8(ASSR);
+
+// EEPROM
+NATIVE_REG8(EECR);
+NATIVE_REG16(EEAR);
+NATIVE_REG8(EEDR);
+
+// Timer bits
+#define WGM10 0
+#define WGM11 1
+#define COM1B0 4
+#define COM1B1 5
+#define COM1A0 6
+#define COM1A1 7
+#define CS10 0
+#define CS11 1
+#define CS12 2
+#define WGM12 3
+#define WGM13 4
+#define TOIE1 0
+#define OCIE1A 1
+#define OCIE1B 2
+#define TOV1 0
+
+#define WGM20 0
+#define WGM21 1
+#define COM2B0 4
+#define COM2B1 5
+#define COM2A0 6
+#define COM2A1 7
+#define CS20 0
+#define CS21 1
+#define CS22 2
+#define WGM22 3
+#define TOIE2 0
+#define OCIE2A 1
+#define OCIE2B 2
+#define OCF2A 1
+
+// EEPROM bits
+#define EERE 0
+#define EEPE 1
+#define EEMPE 2
+#define EERIE 3
+
+#define E2END 0x3FF
+#define RAMEND 0x8FF
+#define RAMSTART 0x100
+
+#endif
@@ -0,0 +1,16 @@
+/*
+ * avr/power.h - power reduction stand-in for the native build
+ */
+
+#ifndef _NATIVE_AVR_POWER_H_
+#define _NATIVE_AVR_POWER_H_
+
+#define power_adc_disable()
+#define power_adc_enable()
+#define power_spi_disable()
+#define power_spi_enable()
+#define power_timer2_disable()
+#define power_timer2_enable()
+#define power_all_enable()
+
+#endif
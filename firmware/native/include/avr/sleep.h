@@ -0,0 +1,17 @@
+/*
+ * avr/sleep.h - sleep mode stand-in for the native build
+ */
+
+#ifndef _NATIVE_AVR_SLEEP_H_
+#define _NATIVE_AVR_SLEEP_H_
+
+#define SLEEP_MODE_IDLE 0
+#define SLEEP_MODE_PWR_DOWN 2
+
+#define set_sleep_mode(mode)
+#define sleep_enable()
+#define sleep_disable()
+#define sleep_cpu()
+#define sleep_mode()
+
+#endif
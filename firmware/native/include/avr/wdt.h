@@ -0,0 +1,30 @@
+/*
+ * avr/wdt.h - watchdog stand-in for the native build
+ *
+ * Enabling the watchdog is only ever done to force a reset, so the host
+ * version hands control to native_reset() and never returns.
+ */
+
+#ifndef _NATIVE_AVR_WDT_H_
+#define _NATIVE_AVR_WDT_H_
+
+#include <avr/io.h>
+
+#define WDTO_15MS 0
+#define WDTO_1S 6
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void native_reset(void) __attribute__((noreturn));
+
+#ifdef __cplusplus
+}
+#endif
+
+#define wdt_enable(timeout) native_reset()
+#define wdt_disable()
+#define wdt_reset()
+
+#endif
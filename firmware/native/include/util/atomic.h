@@ -0,0 +1,22 @@
+/*
+ * util/atomic.h - atomic block stand-in for the native build
+ *
+ * Interrupts are only delivered from nativeService(), never in the middle
+ * of firmware code, but the block still clears the I bit for its duration
+ * so a delay() or service call made inside it holds interrupts off just as
+ * the device would.
+ */
+
+#ifndef _NATIVE_UTIL_ATOMIC_H_
+#define _NATIVE_UTIL_ATOMIC_H_
+
+#include <avr/io.h>
+
+#define ATOMIC_RESTORESTATE	0
+#define ATOMIC_FORCEON			1
+
+#define ATOMIC_BLOCK(type) \
+	for (uint8_t __sreg_save = ((type) ? (SREG | 0x80) : SREG), __todo = (SREG &= (uint8_t)~0x80, 1); \
+		__todo; __todo = 0, SREG = __sreg_save)
+
+#endif
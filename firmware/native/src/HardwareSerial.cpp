@@ -0,0 +1,113 @@
+/*
+ * HardwareSerial.cpp - host-side Serial for the native build
+ */
+
+#include <Arduino.h>
+#include <unistd.h>
+#include <poll.h>
+
+#include "NativeHost.h"
+
+HardwareSerial Serial;
+
+HardwareSerial::HardwareSerial()
+	: _baud(0), _rxHead(0), _rxTail(0), _txCount(0), _echoFd(-1), _inputFd(-1), _capture(true)
+{
+}
+
+void HardwareSerial::begin(unsigned long baud)
+{
+	_baud = baud;
+}
+
+void HardwareSerial::end()
+{
+	_baud = 0;
+}
+
+int HardwareSerial::available()
+{
+	return (_rxHead + SERIAL_NATIVE_BUFFER_SIZE - _rxTail) % SERIAL_NATIVE_BUFFER_SIZE;
+}
+
+int HardwareSerial::read()
+{
+	if (_rxHead == _rxTail) {
+		return -1;
+	}
+	uint8_t c = _rx[_rxTail];
+	nativeActive();
+	_rxTail = (_rxTail + 1) % SERIAL_NATIVE_BUFFER_SIZE;
+	return c;
+}
+
+int HardwareSerial::peek()
+{
+	if (_rxHead == _rxTail) {
+		return -1;
+	}
+	return _rx[_rxTail];
+}
+
+size_t HardwareSerial::write(uint8_t c)
+{
+	nativeActive();
+	if (_echoFd >= 0) {
+		ssize_t n = ::write(_echoFd, &c, 1);
+		(void)n;
+	}
+	if (_capture && _txCount < sizeof(_tx)) {
+		_tx[_txCount++] = c;
+	}
+	return 1;
+}
+
+//bytes that do not fit are dropped, as a full receive buffer would
+size_t HardwareSerial::inject(const char *data, size_t length)
+{
+	size_t n = 0;
+	while (n < length)
+	{
+		size_t next = (_rxHead + 1) % SERIAL_NATIVE_BUFFER_SIZE;
+		if (next == _rxTail) {
+			break;
+		}
+		_rx[_rxHead] = data[n++];
+		_rxHead = next;
+	}
+	return n;
+}
+
+size_t HardwareSerial::inject(const char *data)
+{
+	return inject(data, strlen(data));
+}
+
+size_t HardwareSerial::take(char *buffer, size_t size)
+{
+	size_t n = (_txCount < size) ? _txCount : size;
+	memcpy(buffer, _tx, n);
+	memmove(_tx, _tx + n, _txCount - n);
+	_txCount -= n;
+	return n;
+}
+
+void HardwareSerial::poll()
+{
+	if (_inputFd < 0) {
+		return;
+	}
+	struct pollfd fd = {_inputFd, POLLIN, 0};
+	char buffer[64];
+	size_t room = SERIAL_NATIVE_BUFFER_SIZE - 1 - available();
+	if (room == 0 || ::poll(&fd, 1, 0) <= 0 || !(fd.revents & POLLIN)) {
+		return;
+	}
+	ssize_t n = ::read(_inputFd, buffer, (room < sizeof(buffer)) ? room : sizeof(buffer));
+	if (n <= 0) {
+		// end of input, stop polling
+		_inputFd = -1;
+		return;
+	}
+	inject(buffer, n);
+}
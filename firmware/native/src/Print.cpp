@@ -0,0 +1,209 @@
+/*
+ * Print.cpp - Arduino Print and Stream for the native build
+ *
+ * Number formatting follows the Arduino core so the firmware's output is
+ * byte for byte what the device sends.
+ */
+
+#include <Arduino.h>
+
+#include "NativeHost.h"
+
+size_t Print::write(const uint8_t *buffer, size_t size)
+{
+	size_t n = 0;
+	while (size--) {
+		n += write(*buffer++);
+	}
+	return n;
+}
+
+size_t Print::write(const char *str)
+{
+	if (str == NULL) {
+		return 0;
+	}
+	return write((const uint8_t *)str, strlen(str));
+}
+
+size_t Print::print(const __FlashStringHelper *s)
+{
+	return print(reinterpret_cast<const char *>(s));
+}
+
+size_t Print::print(const char s[])
+{
+	return write(s);
+}
+
+size_t Print::print(char c)
+{
+	return write((uint8_t)c);
+}
+
+size_t Print::print(unsigned char b, int base)
+{
+	return print((unsigned long)b, base);
+}
+
+size_t Print::print(int n, int base)
+{
+	return print((long)n, base);
+}
+
+size_t Print::print(unsigned int n, int base)
+{
+	return print((unsigned long)n, base);
+}
+
+size_t Print::print(long n, int base)
+{
+	if (base == 0) {
+		return write((uint8_t)n);
+	}
+	if (base == 10 && n < 0) {
+		size_t t = print('-');
+		return printNumber(-(unsigned long)n, 10) + t;
+	}
+	return printNumber((uint32_t)n, base);
+}
+
+size_t Print::print(unsigned long n, int base)
+{
+	if (base == 0) {
+		return write((uint8_t)n);
+	}
+	return printNumber((uint32_t)n, base);
+}
+
+size_t Print::print(double n, int digits)
+{
+	return printFloat(n, digits);
+}
+
+size_t Print::println(void)
+{
+	return write("\r\n");
+}
+
+size_t Print::println(const __FlashStringHelper *s)
+{
+	return print(s) + println();
+}
+
+size_t Print::println(const char c[])
+{
+	return print(c) + println();
+}
+
+size_t Print::println(char c)
+{
+	return print(c) + println();
+}
+
+size_t Print::println(unsigned char b, int base)
+{
+	return print(b, base) + println();
+}
+
+size_t Print::println(int n, int base)
+{
+	return print(n, base) + println();
+}
+
+size_t Print::println(unsigned int n, int base)
+{
+	return print(n, base) + println();
+}
+
+size_t Print::println(long n, int base)
+{
+	return print(n, base) + println();
+}
+
+size_t Print::println(unsigned long n, int base)
+{
+	return print(n, base) + println();
+}
+
+size_t Print::println(double n, int digits)
+{
+	return print(n, digits) + println();
+}
+
+//unsigned long is 32 bits on the device, so values are cut to that first
+size_t Print::printNumber(unsigned long n, uint8_t base)
+{
+	char buf[8 * sizeof(uint32_t) + 1];
+	char *str = &buf[sizeof(buf) - 1];
+	uint32_t value = (uint32_t)n;
+
+	*str = '\0';
+	if (base < 2) {
+		base = 10;
+	}
+	do {
+		char c = value % base;
+		value /= base;
+		*--str = c < 10 ? c + '0' : c + 'A' - 10;
+	} while (value);
+
+	return write(str);
+}
+
+size_t Print::printFloat(double number, uint8_t digits)
+{
+	size_t n = 0;
+
+	if (isnan(number)) return print("nan");
+	if (isinf(number)) return print("inf");
+	if (number > 4294967040.0) return print("ovf");
+	if (number < -4294967040.0) return print("ovf");
+
+	if (number < 0.0) {
+		n += print('-');
+		number = -number;
+	}
+
+	double rounding = 0.5;
+	for (uint8_t i = 0; i < digits; ++i) {
+		rounding /= 10.0;
+	}
+	number += rounding;
+
+	uint32_t intPart = (uint32_t)number;
+	double remainder = number - (double)intPart;
+	n += print((unsigned long)intPart);
+
+	if (digits > 0) {
+		n += print('.');
+	}
+	while (digits-- > 0)
+	{
+		remainder *= 10.0;
+		unsigned int toPrint = (unsigned int)remainder;
+		n += print(toPrint);
+		remainder -= toPrint;
+	}
+	return n;
+}
+
+size_t Stream::readBytes(char *buffer, size_t length)
+{
+	size_t count = 0;
+	unsigned long start = millis();
+	while (count < length)
+	{
+		int c = read();
+		if (c < 0) {
+			if (millis() - start >= _timeout) {
+				break;
+			}
+			nativeWait();
+			continue;
+		}
+		*buffer++ = (char)c;
+		count++;
+	}
+	return count;
+}
@@ -0,0 +1,7 @@
+/*
+ * SPI.cpp - SPI stand-in for the native build
+ */
+
+#include <SPI.h>
+
+SPIClass SPI;
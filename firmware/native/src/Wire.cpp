@@ -0,0 +1,162 @@
+/*
+ * Wire.cpp - I2C stand-in for the native build
+ *
+ * Return codes follow the AVR TwoWire: endTransmission() gives 0 on success
+ * and 2 when the address is not acknowledged, 4 on a stuck bus,
+ * requestFrom() gives the number of bytes received.
+ */
+
+#include <Arduino.h>
+#include <Wire.h>
+
+#include "NativeHost.h"
+
+#define WIRE_DEFAULT_CLOCK		100000UL
+
+TwoWire Wire;
+
+TwoWire::TwoWire()
+	: _txAddress(0), _txLength(0), _transmitting(false), _rxIndex(0), _rxLength(0), _transactions(0), _errors(0), _clock(WIRE_DEFAULT_CLOCK), _stuck(false)
+{
+	for (uint8_t i = 0; i < WIRE_MAX_DEVICES; i++) {
+		_devices[i] = NULL;
+	}
+}
+
+void TwoWire::begin()
+{
+	_rxIndex = 0;
+	_rxLength = 0;
+	_txLength = 0;
+	_transmitting = false;
+}
+
+bool TwoWire::attach(uint8_t address, I2CDevice *device)
+{
+	detach(address);
+	for (uint8_t i = 0; i < WIRE_MAX_DEVICES; i++)
+	{
+		if (_devices[i] == NULL) {
+			_addresses[i] = address;
+			_devices[i] = device;
+			return true;
+		}
+	}
+	return false;
+}
+
+void TwoWire::detach(uint8_t address)
+{
+	for (uint8_t i = 0; i < WIRE_MAX_DEVICES; i++)
+	{
+		if (_devices[i] != NULL && _addresses[i] == address) {
+			_devices[i] = NULL;
+		}
+	}
+}
+
+//bytes does not count the address byte
+void TwoWire::transfer(uint8_t bytes)
+{
+	_transactions++;
+	nativeActive();
+	nativeAdvance(((uint64_t)bytes + 1) * 9 * 1000000 / _clock);
+}
+
+I2CDevice *TwoWire::find(uint8_t address)
+{
+	for (uint8_t i = 0; i < WIRE_MAX_DEVICES; i++)
+	{
+		if (_devices[i] != NULL && _addresses[i] == address) {
+			return _devices[i];
+		}
+	}
+	return NULL;
+}
+
+void TwoWire::beginTransmission(uint8_t address)
+{
+	_txAddress = address;
+	_txLength = 0;
+	_transmitting = true;
+}
+
+uint8_t TwoWire::endTransmission(uint8_t sendStop)
+{
+	(void)sendStop;
+	_transmitting = false;
+	if (_stuck) {
+		transfer(0);
+		_errors++;
+		return 4;
+	}
+	I2CDevice *device = find(_txAddress);
+	if (device == NULL) {
+		transfer(0);
+		_errors++;
+		return 2;
+	}
+	transfer(_txLength);
+	if (!device->i2cWrite(_txBuffer, _txLength)) {
+		_errors++;
+		return 2;
+	}
+	return 0;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity)
+{
+	if (quantity > BUFFER_LENGTH) {
+		quantity = BUFFER_LENGTH;
+	}
+	_rxIndex = 0;
+	_rxLength = 0;
+	I2CDevice *device = _stuck ? NULL : find(address);
+	if (device != NULL) {
+		_rxLength = device->i2cRead(_rxBuffer, quantity);
+	}
+	if (_rxLength == 0) {
+		_errors++;
+	}
+	transfer(_rxLength);
+	return _rxLength;
+}
+
+size_t TwoWire::write(uint8_t data)
+{
+	if (!_transmitting || _txLength >= BUFFER_LENGTH) {
+		return 0;
+	}
+	_txBuffer[_txLength++] = data;
+	return 1;
+}
+
+size_t TwoWire::write(const uint8_t *data, size_t quantity)
+{
+	size_t n = 0;
+	while (n < quantity && write(data[n])) {
+		n++;
+	}
+	return n;
+}
+
+int TwoWire::available(void)
+{
+	return _rxLength - _rxIndex;
+}
+
+int TwoWire::read(void)
+{
+	if (_rxIndex >= _rxLength) {
+		return -1;
+	}
+	return _rxBuffer[_rxIndex++];
+}
+
+int TwoWire::peek(void)
+{
+	if (_rxIndex >= _rxLength) {
+		return -1;
+	}
+	return _rxBuffer[_rxIndex];
+}
@@ -0,0 +1,160 @@
+/*
+ * core.cpp - Arduino core functions for the native build
+ *
+ * millis() and micros() run off the host's monotonic clock, or off a
+ * virtual clock that a harness moves on. Pins only remember what was last
+ * written so a harness can look at them, unless the harness drives them.
+ */
+
+#include <Arduino.h>
+#include <time.h>
+
+#include "NativeHost.h"
+
+static uint8_t pinModes[NATIVE_PINS];
+static uint8_t pinLevels[NATIVE_PINS];
+static bool pinDriven[NATIVE_PINS];
+static bool virtualClock = false;
+static uint64_t virtualNow = 0;
+static uint32_t activity = 0;
+
+void nativeUseVirtualClock(void)
+{
+	virtualClock = true;
+}
+
+bool nativeVirtualClock(void)
+{
+	return virtualClock;
+}
+
+//only ever moves forward; nativeAdvanceTo() decides where to stop
+void nativeSetVirtualMicros(uint64_t us)
+{
+	if (us > virtualNow) {
+		virtualNow = us;
+	}
+}
+
+void nativeAdvance(uint64_t us)
+{
+	nativeAdvanceTo(virtualNow + us);
+}
+
+void nativePinEdge(uint8_t pin, uint8_t previous, uint8_t level);
+
+uint32_t nativeActivity(void)
+{
+	return activity;
+}
+
+void nativeActive(void)
+{
+	activity++;
+}
+
+uint64_t nativeMicros(void)
+{
+	if (virtualClock) {
+		return virtualNow;
+	}
+	static uint64_t start = 0;
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	uint64_t now = (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+	if (start == 0) {
+		start = now;
+	}
+	return now - start;
+}
+
+unsigned long millis(void)
+{
+	return (uint32_t)(nativeMicros() / 1000);
+}
+
+unsigned long micros(void)
+{
+	return (uint32_t)nativeMicros();
+}
+
+void delay(unsigned long ms)
+{
+	if (virtualClock) {
+		nativeAdvance((uint64_t)ms * 1000);
+		return;
+	}
+	uint64_t end = nativeMicros() + (uint64_t)ms * 1000;
+	while (nativeMicros() < end) {
+		nativeService();
+	}
+}
+
+void delayMicroseconds(unsigned int us)
+{
+	if (virtualClock) {
+		nativeAdvance(us);
+		return;
+	}
+	uint64_t end = nativeMicros() + us;
+	while (nativeMicros() < end) {
+	}
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+	if (pin < NATIVE_PINS) {
+		pinModes[pin] = mode;
+	}
+}
+
+void digitalWrite(uint8_t pin, uint8_t val)
+{
+	if (pin < NATIVE_PINS) {
+		pinLevels[pin] = val ? HIGH : LOW;
+	}
+}
+
+int digitalRead(uint8_t pin)
+{
+	if (pin >= NATIVE_PINS) {
+		return LOW;
+	}
+	// an input with the pull-up on floats high
+	if (!pinDriven[pin] && pinModes[pin] == INPUT_PULLUP) {
+		return HIGH;
+	}
+	return pinLevels[pin];
+}
+
+int analogRead(uint8_t pin)
+{
+	(void)pin;
+	return 0;
+}
+
+void analogWrite(uint8_t pin, int val)
+{
+	digitalWrite(pin, val >= 128);
+}
+
+uint8_t nativePinMode(uint8_t pin)
+{
+	return (pin < NATIVE_PINS) ? pinModes[pin] : INPUT;
+}
+
+uint8_t nativePinLevel(uint8_t pin)
+{
+	return (pin < NATIVE_PINS) ? pinLevels[pin] : LOW;
+}
+
+void nativeDrivePin(uint8_t pin, uint8_t level)
+{
+	if (pin >= NATIVE_PINS) {
+		return;
+	}
+	uint8_t previous = digitalRead(pin);
+	pinDriven[pin] = true;
+	pinLevels[pin] = level ? HIGH : LOW;
+	nativePinEdge(pin, previous, pinLevels[pin]);
+}
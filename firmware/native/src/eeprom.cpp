@@ -0,0 +1,149 @@
+/*
+ * eeprom.cpp - file backed EEPROM for the native build
+ *
+ * The image starts erased (0xFF). If SENSORHUB_EEPROM names a file it is
+ * loaded on first access and rewritten after every write, so settings
+ * survive between runs just like on the device.
+ *
+ * Each byte write keeps EEPE set for NATIVE_EEPROM_WRITE_US, and like
+ * avr-libc a read or write first waits for the previous write to finish,
+ * so the write queue and its EE_READY interrupt see realistic timing.
+ */
+
+#include <avr/eeprom.h>
+#include <avr/io.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "NativeHost.h"
+
+static uint8_t image[NATIVE_EEPROM_SIZE];
+static bool loaded = false;
+static uint32_t writes = 0;
+static uint64_t busyUntil = 0;
+
+static void load(void)
+{
+	if (loaded) return;
+	loaded = true;
+	memset(image, 0xFF, sizeof(image));
+	const char *path = getenv("SENSORHUB_EEPROM");
+	if (path) {
+		FILE *f = fopen(path, "rb");
+		if (f) {
+			size_t n = fread(image, 1, sizeof(image), f);
+			(void)n;
+			fclose(f);
+		}
+	}
+}
+
+static void store(void)
+{
+	const char *path = getenv("SENSORHUB_EEPROM");
+	if (path) {
+		FILE *f = fopen(path, "wb");
+		if (f) {
+			fwrite(image, 1, sizeof(image), f);
+			fclose(f);
+		}
+	}
+}
+
+static size_t offset(const void *p)
+{
+	return ((size_t)p) % NATIVE_EEPROM_SIZE;
+}
+
+uint8_t *nativeEeprom(void)
+{
+	load();
+	return image;
+}
+
+uint32_t nativeEepromWrites(void)
+{
+	return writes;
+}
+
+bool nativeEepromBusy(void)
+{
+	return !eeprom_is_ready();
+}
+
+uint64_t nativeEepromReadyAt(void)
+{
+	return busyUntil;
+}
+
+int eeprom_is_ready(void)
+{
+	if ((EECR & _BV(EEPE)) && nativeMicros() >= busyUntil)
+		EECR &= (uint8_t)~_BV(EEPE);
+	return !(EECR & _BV(EEPE));
+}
+
+uint8_t eeprom_read_byte(const void *p)
+{
+	load();
+	eeprom_busy_wait();
+	return image[offset(p)];
+}
+
+uint16_t eeprom_read_word(const void *p)
+{
+	uint16_t value;
+	eeprom_read_block(&value, p, sizeof(value));
+	return value;
+}
+
+uint32_t eeprom_read_dword(const void *p)
+{
+	uint32_t value;
+	eeprom_read_block(&value, p, sizeof(value));
+	return value;
+}
+
+void eeprom_read_block(void *dst, const void *src, size_t n)
+{
+	load();
+	eeprom_busy_wait();
+	for (size_t i = 0; i < n; i++)
+		((uint8_t *)dst)[i] = image[(offset(src) + i) % NATIVE_EEPROM_SIZE];
+}
+
+void eeprom_write_byte(void *p, uint8_t value)
+{
+	load();
+	eeprom_busy_wait();
+	image[offset(p)] = value;
+	writes++;
+	nativeActive();
+	store();
+	// avr-libc writes EEMPE on its own to start the write, clearing EERIE
+	EECR = _BV(EEPE);
+	busyUntil = nativeMicros() + NATIVE_EEPROM_WRITE_US;
+}
+
+void eeprom_write_word(void *p, uint16_t value)
+{
+	eeprom_write_block(&value, p, sizeof(value));
+}
+
+void eeprom_write_dword(void *p, uint32_t value)
+{
+	eeprom_write_block(&value, p, sizeof(value));
+}
+
+void eeprom_write_block(const void *src, void *dst, size_t n)
+{
+	for (size_t i = 0; i < n; i++)
+		eeprom_write_byte((uint8_t *)dst + i, ((const uint8_t *)src)[i]);
+}
+
+void eeprom_update_byte(void *p, uint8_t value)
+{
+	if (eeprom_read_byte(p) != value)
+		eeprom_write_byte(p, value);
+}
@@ -0,0 +1,55 @@
+/*
+ * host.cpp - main() for the native build
+ *
+ * Runs the firmware as a process. Serial is wired to stdin and stdout, so
+ * CmdMessenger commands can be typed or piped in, and the EEPROM is kept in
+ * the file named by SENSORHUB_EEPROM. A harness that wants to drive the
+ * firmware itself builds with NATIVE_NO_MAIN and calls the NativeHost.h
+ * functions instead.
+ */
+
+#include <Arduino.h>
+#include <avr/wdt.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "NativeHost.h"
+
+static char **hostArgv = NULL;
+
+void nativeRun(void)
+{
+	// the Arduino core enables interrupts before setup()
+	SREG |= 0x80;
+	setup();
+	for (;;)
+	{
+		loop();
+		nativeService();
+	}
+}
+
+//the device resets through the watchdog; start the process over the same
+//way so RAM is cleared and only the EEPROM carries over
+extern "C" void native_reset(void)
+{
+	while (nativeEepromBusy()) {
+		nativeWait();
+	}
+	if (hostArgv != NULL) {
+		execv("/proc/self/exe", hostArgv);
+	}
+	exit(0);
+}
+
+#ifndef NATIVE_NO_MAIN
+int main(int argc, char **argv)
+{
+	(void)argc;
+	hostArgv = argv;
+	Serial.setInput(STDIN_FILENO);
+	Serial.setEcho(STDOUT_FILENO);
+	Serial.setCapture(false);
+	nativeRun();
+}
+#endif
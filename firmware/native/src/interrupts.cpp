@@ -0,0 +1,319 @@
+/*
+ * interrupts.cpp - timer and EEPROM interrupt emulation for the native build
+ *
+ * Nothing here knows about TimerOne or TimerTwo. The period of each timer is
+ * worked out from its registers the way the hardware would, from the clock
+ * select bits and TOP, and the vector runs once per period as long as its
+ * enable bit and the I bit in SREG are set. Otherwise the flag is left set
+ * in TIFRx until it can run. EE_READY runs while EERIE is set and no write
+ * is in progress, which is how the hardware treats it too. INT0 and INT1
+ * take the handlers given to attachInterrupt() and are raised by
+ * nativeDrivePin() on pins 2 and 3.
+ *
+ * On the virtual clock, time moves from one event to the next. A timer
+ * whose interrupt is off is not stepped through period by period, so an
+ * idle PWM carrier costs nothing.
+ *
+ * Vectors are weak so a build that leaves a library out still links.
+ */
+
+#include <Arduino.h>
+#include <avr/eeprom.h>
+
+#include "NativeHost.h"
+
+extern "C" void TIMER1_OVF_vect(void) __attribute__((weak));
+extern "C" void TIMER2_COMPA_vect(void) __attribute__((weak));
+extern "C" void EE_READY_vect(void) __attribute__((weak));
+
+#define NATIVE_CYCLES_PER_US		(F_CPU / 1000000UL)
+#define NATIVE_EE_READY_MAX			64		// per service, in case a handler never clears EERIE
+#define NATIVE_WAIT_MAX_US			1000	// longest step nativeWait() takes on the virtual clock
+#define NATIVE_EXT_INTERRUPTS		2			// INT0 on pin 2, INT1 on pin 3
+#define NATIVE_EXT_PIN(n)				((n) + 2)
+
+void nativeSetVirtualMicros(uint64_t us);
+
+static const uint16_t timer1Prescale[8] = {0, 1, 8, 64, 256, 1024, 0, 0};
+static const uint16_t timer2Prescale[8] = {0, 1, 8, 32, 64, 128, 256, 1024};
+
+struct NativeTimer
+{
+	uint32_t period;			//cycles, 0 while stopped
+	uint64_t due;					//cycle count of the next event
+};
+
+struct NativeExternal
+{
+	void (*handler)(void);
+	int mode;
+	bool flag;
+};
+
+static NativeTimer timer1;
+static NativeTimer timer2;
+static NativeExternal external[NATIVE_EXT_INTERRUPTS];
+static uint32_t counts[NATIVE_VECTORS];
+static bool servicing = false;
+
+//phase and frequency correct PWM counts up to ICR1 and back down, and
+//overflows at BOTTOM; every other mode is taken as the normal 16 bit count
+static uint32_t timer1Period(void)
+{
+	uint32_t prescale = timer1Prescale[TCCR1B & 0x07];
+	if (TCCR1B & _BV(WGM13)) {
+		return 2UL * ICR1 * prescale;
+	}
+	return 65536UL * prescale;
+}
+
+//CTC mode clears the count on a match with OCR2A, normal mode wraps at 256
+static uint32_t timer2Period(void)
+{
+	uint32_t prescale = timer2Prescale[TCCR2B & 0x07];
+	if (TCCR2A & _BV(WGM21)) {
+		return ((uint32_t)OCR2A + 1) * prescale;
+	}
+	return 256UL * prescale;
+}
+
+//restart the count whenever the period changes, as a register write would
+static void timerUpdate(NativeTimer &timer, uint32_t period, uint64_t now)
+{
+	if (period != timer.period) {
+		timer.period = period;
+		timer.due = now + period;
+	}
+}
+
+static void runVector(uint8_t index, void (*handler)(void))
+{
+	counts[index]++;
+	nativeActive();
+	if (handler == NULL) {
+		return;
+	}
+	uint8_t sreg = SREG;
+	SREG &= (uint8_t)~0x80;
+	handler();
+	SREG = sreg;
+}
+
+static bool interruptsOn(void)
+{
+	return SREG & 0x80;
+}
+
+static bool timer1Enabled(void)
+{
+	return TIMSK1 & _BV(TOIE1);
+}
+
+static bool timer2Enabled(void)
+{
+	return TIMSK2 & _BV(OCIE2A);
+}
+
+//LOW keeps the interrupt coming for as long as the pin is held low
+static bool externalDue(uint8_t n)
+{
+	const NativeExternal &ext = external[n];
+	if (ext.handler == NULL) {
+		return false;
+	}
+	return ext.flag || (ext.mode == LOW && digitalRead(NATIVE_EXT_PIN(n)) == LOW);
+}
+
+static bool pending(void)
+{
+	return (EECR & _BV(EERIE)) || ((TIFR1 & _BV(TOV1)) && timer1Enabled()) ||
+		((TIFR2 & _BV(OCF2A)) && timer2Enabled()) || externalDue(0) || externalDue(1);
+}
+
+//runs whatever has its flag and enable bit set, once the I bit allows,
+//in vector order
+static void runPending(void)
+{
+	if (!interruptsOn()) {
+		return;
+	}
+	for (uint8_t n = 0; n < NATIVE_EXT_INTERRUPTS; n++)
+	{
+		if (externalDue(n)) {
+			external[n].flag = false;
+			runVector(NATIVE_VECT_INT0 + n, external[n].handler);
+		}
+	}
+	if ((TIFR1 & _BV(TOV1)) && timer1Enabled()) {
+		TIFR1 &= (uint8_t)~_BV(TOV1);
+		runVector(NATIVE_VECT_TIMER1_OVF, TIMER1_OVF_vect);
+	}
+	if ((TIFR2 & _BV(OCF2A)) && timer2Enabled()) {
+		TIFR2 &= (uint8_t)~_BV(OCF2A);
+		runVector(NATIVE_VECT_TIMER2_COMPA, TIMER2_COMPA_vect);
+	}
+}
+
+//a timer nobody listens to only needs its flag set and its next event moved
+//past now, however many periods that is
+static void timerSkip(NativeTimer &timer, uint64_t now, volatile uint8_t &flags, uint8_t flag)
+{
+	if (timer.period && timer.due <= now) {
+		timer.due += ((now - timer.due) / timer.period + 1) * timer.period;
+		flags |= _BV(flag);
+	}
+}
+
+void nativeService(void)
+{
+	if (servicing) {
+		return;
+	}
+	servicing = true;
+
+	uint64_t now = nativeMicros() * NATIVE_CYCLES_PER_US;
+	runPending();
+	for (;;)
+	{
+		timerUpdate(timer1, timer1Period(), now);
+		timerUpdate(timer2, timer2Period(), now);
+		if (!timer1Enabled()) {
+			timerSkip(timer1, now, TIFR1, TOV1);
+		}
+		if (!timer2Enabled()) {
+			timerSkip(timer2, now, TIFR2, OCF2A);
+		}
+		NativeTimer *next = NULL;
+		if (timer1.period && timer1.due <= now) {
+			next = &timer1;
+		}
+		if (timer2.period && timer2.due <= now && (next == NULL || timer2.due < next->due)) {
+			next = &timer2;
+		}
+		if (next == NULL) {
+			break;
+		}
+		next->due += next->period;
+		if (next == &timer1) {
+			TIFR1 |= _BV(TOV1);
+		}
+		else {
+			TIFR2 |= _BV(OCF2A);
+		}
+		runPending();
+	}
+
+	for (uint8_t i = 0; i < NATIVE_EE_READY_MAX; i++)
+	{
+		//checked first, it also clears EEPE once the write time is up
+		if (!eeprom_is_ready() || !(EECR & _BV(EERIE)) || !interruptsOn()) {
+			break;
+		}
+		runVector(NATIVE_VECT_EE_READY, EE_READY_vect);
+	}
+
+	Serial.poll();
+	servicing = false;
+}
+
+static uint64_t timerNext(const NativeTimer &timer, bool enabled)
+{
+	if (!timer.period || !enabled) {
+		return UINT64_MAX;
+	}
+	return (timer.due + NATIVE_CYCLES_PER_US - 1) / NATIVE_CYCLES_PER_US;
+}
+
+uint64_t nativeNextEvent(void)
+{
+	uint64_t next = timerNext(timer1, timer1Enabled());
+	uint64_t t2 = timerNext(timer2, timer2Enabled());
+	if (t2 < next) {
+		next = t2;
+	}
+	if ((EECR & _BV(EEPE)) && nativeEepromReadyAt() < next) {
+		next = nativeEepromReadyAt();
+	}
+	return next;
+}
+
+void nativeAdvanceTo(uint64_t us)
+{
+	if (!nativeVirtualClock()) {
+		return;
+	}
+	//called from a handler, which holds every other interrupt off anyway
+	if (servicing) {
+		nativeSetVirtualMicros(us);
+		return;
+	}
+	for (;;)
+	{
+		uint64_t next = nativeNextEvent();
+		if (next > us) {
+			break;
+		}
+		nativeSetVirtualMicros(next);
+		nativeService();
+	}
+	nativeSetVirtualMicros(us);
+	//nothing came due on the way, only a level triggered or held off
+	//interrupt can still want running
+	if (pending()) {
+		nativeService();
+	}
+}
+
+void nativeWait(void)
+{
+	if (!nativeVirtualClock()) {
+		nativeService();
+		return;
+	}
+	uint64_t now = nativeMicros();
+	uint64_t next = nativeNextEvent();
+	if (next <= now) {
+		next = now + 1;
+	}
+	if (next > now + NATIVE_WAIT_MAX_US) {
+		next = now + NATIVE_WAIT_MAX_US;
+	}
+	nativeAdvanceTo(next);
+}
+
+void attachInterrupt(uint8_t interruptNum, void (*userFunc)(void), int mode)
+{
+	if (interruptNum < NATIVE_EXT_INTERRUPTS) {
+		external[interruptNum].handler = userFunc;
+		external[interruptNum].mode = mode;
+		external[interruptNum].flag = false;
+	}
+}
+
+void detachInterrupt(uint8_t interruptNum)
+{
+	if (interruptNum < NATIVE_EXT_INTERRUPTS) {
+		external[interruptNum].handler = NULL;
+	}
+}
+
+//from nativeDrivePin(); the flag is latched even with the I bit clear
+void nativePinEdge(uint8_t pin, uint8_t previous, uint8_t level)
+{
+	uint8_t n = pin - NATIVE_EXT_PIN(0);
+	if (n >= NATIVE_EXT_INTERRUPTS || external[n].handler == NULL || previous == level) {
+		return;
+	}
+	int mode = external[n].mode;
+	if (mode == CHANGE || (mode == FALLING && level == LOW) || (mode == RISING && level == HIGH)) {
+		external[n].flag = true;
+	}
+	if (pending()) {
+		nativeService();
+	}
+}
+
+uint32_t nativeInterrupts(uint8_t vector)
+{
+	return (vector < NATIVE_VECTORS) ? counts[vector] : 0;
+}
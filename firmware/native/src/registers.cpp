@@ -0,0 +1,42 @@
+/*
+ * registers.cpp - ATmega328P register file for the native build
+ *
+ * Values after reset match the datasheet, which is all zeros for the
+ * registers used here.
+ */
+
+#include <avr/io.h>
+
+volatile uint8_t SREG;
+volatile uint8_t MCUSR;
+
+volatile uint8_t TCCR0A;
+volatile uint8_t TCCR0B;
+volatile uint8_t TCNT0;
+volatile uint8_t OCR0A;
+volatile uint8_t OCR0B;
+volatile uint8_t TIMSK0;
+volatile uint8_t TIFR0;
+
+volatile uint8_t TCCR1A;
+volatile uint8_t TCCR1B;
+volatile uint8_t TCCR1C;
+volatile uint16_t TCNT1;
+volatile uint16_t ICR1;
+volatile uint16_t OCR1A;
+volatile uint16_t OCR1B;
+volatile uint8_t TIMSK1;
+volatile uint8_t TIFR1;
+
+volatile uint8_t TCCR2A;
+volatile uint8_t TCCR2B;
+volatile uint8_t TCNT2;
+volatile uint8_t OCR2A;
+volatile uint8_t OCR2B;
+volatile uint8_t TIMSK2;
+volatile uint8_t TIFR2;
+volatile uint8_t ASSR;
+
+volatile uint8_t EECR;
+volatile uint16_t EEAR;
+volatile uint8_t EEDR;
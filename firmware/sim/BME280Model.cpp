@@ -0,0 +1,404 @@
+/*
+ * BME280Model.cpp - BME280 humidity, pressure and temperature sensor on the
+ * simulated I2C bus
+ */
+
+#include "BME280Model.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "NativeHost.h"
+
+#define REG_CALIB_00			0x88
+#define REG_CALIB_26			0xE1
+#define REG_ID						0xD0
+#define REG_RESET					0xE0
+#define REG_CTRL_HUM			0xF2
+#define REG_STATUS				0xF3
+#define REG_CTRL_MEAS			0xF4
+#define REG_CONFIG				0xF5
+#define REG_PRESS_MSB			0xF7
+#define REG_TEMP_MSB			0xFA
+#define REG_HUM_MSB				0xFD
+
+#define RESET_WORD				0xB6
+#define STATUS_MEASURING	0x08
+#define STATUS_IM_UPDATE	0x01
+#define MODE_SLEEP				0x00
+#define MODE_NORMAL				0x03
+#define MODE_MASK					0x03
+
+#define ADC_SKIPPED_20		0x80000UL	// a channel with oversampling off
+#define ADC_SKIPPED_16		0x8000UL
+#define ADC_MAX_20				0xFFFFFUL
+#define ADC_MAX_16				0xFFFFUL
+#define NVM_COPY_US				2000
+// a long idle stretch only needs the last few conversions for the filter
+// to settle on the same input
+#define CONVERSIONS_MAX		32
+
+// Trimming constants, the example set from the datasheet for temperature
+// and pressure and a typical part for humidity.
+static const uint16_t digT1 = 27504;
+static const int16_t digT2 = 26435;
+static const int16_t digT3 = -1000;
+static const uint16_t digP1 = 36477;
+static const int16_t digP2 = -10685;
+static const int16_t digP3 = 3024;
+static const int16_t digP4 = 2855;
+static const int16_t digP5 = 140;
+static const int16_t digP6 = -7;
+static const int16_t digP7 = 15500;
+static const int16_t digP8 = -14600;
+static const int16_t digP9 = 6000;
+static const uint8_t digH1 = 75;
+static const int16_t digH2 = 367;
+static const uint8_t digH3 = 0;
+static const int16_t digH4 = 296;
+static const int16_t digH5 = 50;
+static const int8_t digH6 = 30;
+
+// us, by t_sb
+static const uint32_t standbyUs[8] = {500, 62500, 125000, 250000, 500000, 1000000, 10000, 20000};
+
+// The compensation from the datasheet, which the driver also uses. The raw
+// values are found by searching these, so they read back as set.
+
+// 0.01 degC
+static int32_t compensateT(int32_t adc, int32_t &tFine)
+{
+	int32_t var1 = ((((adc >> 3) - ((int32_t)digT1 << 1))) * ((int32_t)digT2)) >> 11;
+	int32_t var2 = (((((adc >> 4) - ((int32_t)digT1)) * ((adc >> 4) - ((int32_t)digT1))) >> 12) *
+		((int32_t)digT3)) >> 14;
+	tFine = var1 + var2;
+	return (tFine * 5 + 128) >> 8;
+}
+
+// Pa in Q24.8
+static uint32_t compensateP(int32_t adc, int32_t tFine)
+{
+	int64_t var1, var2, p;
+	var1 = ((int64_t)tFine) - 128000;
+	var2 = var1 * var1 * (int64_t)digP6;
+	var2 = var2 + ((var1 * (int64_t)digP5) << 17);
+	var2 = var2 + (((int64_t)digP4) << 35);
+	var1 = ((var1 * var1 * (int64_t)digP3) >> 8) + ((var1 * (int64_t)digP2) << 12);
+	var1 = (((((int64_t)1) << 47) + var1)) * ((int64_t)digP1) >> 33;
+	if (var1 == 0) {
+		return 0;
+	}
+	p = 1048576 - adc;
+	p = (((p << 31) - var2) * 3125) / var1;
+	var1 = (((int64_t)digP9) * (p >> 13) * (p >> 13)) >> 25;
+	var2 = (((int64_t)digP8) * p) >> 19;
+	p = ((p + var1 + var2) >> 8) + (((int64_t)digP7) << 4);
+	return (uint32_t)p;
+}
+
+// %RH in Q22.10
+static uint32_t compensateH(int32_t adc, int32_t tFine)
+{
+	int32_t v = (tFine - ((int32_t)76800));
+	v = (((((adc << 14) - (((int32_t)digH4) << 20) - (((int32_t)digH5) * v)) +
+		((int32_t)16384)) >> 15) * (((((((v * ((int32_t)digH6)) >> 10) * (((v *
+		((int32_t)digH3)) >> 11) + ((int32_t)32768))) >> 10) + ((int32_t)2097152)) *
+		((int32_t)digH2) + 8192) >> 14));
+	v = (v - (((((v >> 15) * (v >> 15)) >> 7) * ((int32_t)digH1)) >> 4));
+	v = (v < 0 ? 0 : v);
+	v = (v > 419430400 ? 419430400 : v);
+	return (uint32_t)(v >> 12);
+}
+
+static uint32_t rawTemperature(double celsius)
+{
+	int32_t target = (int32_t)lround(celsius * 100);
+	uint32_t lo = 0;
+	uint32_t hi = ADC_MAX_20;
+	int32_t tFine;
+	while (lo < hi)
+	{
+		uint32_t mid = (lo + hi) / 2;
+		if (compensateT(mid, tFine) < target) {
+			lo = mid + 1;
+		}
+		else {
+			hi = mid;
+		}
+	}
+	return lo;
+}
+
+//higher pressure reads as a lower count
+static uint32_t rawPressure(double pa, int32_t tFine)
+{
+	uint32_t target = (uint32_t)lround(pa * 256);
+	uint32_t lo = 0;
+	uint32_t hi = ADC_MAX_20;
+	while (lo < hi)
+	{
+		uint32_t mid = (lo + hi) / 2;
+		if (compensateP(mid, tFine) > target) {
+			lo = mid + 1;
+		}
+		else {
+			hi = mid;
+		}
+	}
+	return lo;
+}
+
+static uint32_t rawHumidity(double rh, int32_t tFine)
+{
+	uint32_t target = (uint32_t)lround(rh * 1024);
+	uint32_t lo = 0;
+	uint32_t hi = ADC_MAX_16;
+	while (lo < hi)
+	{
+		uint32_t mid = (lo + hi) / 2;
+		if (compensateH(mid, tFine) < target) {
+			lo = mid + 1;
+		}
+		else {
+			hi = mid;
+		}
+	}
+	return lo;
+}
+
+//1 to 16 times, codes above 5 are 16 times as well
+static uint8_t oversampling(uint8_t osrs)
+{
+	return (osrs == 0) ? 0 : 1 << ((osrs > 5 ? 5 : osrs) - 1);
+}
+
+//without the filter a reading has 16 bits at 1x oversampling and one more
+//for each doubling; the filter brings it up to the full 20
+static uint32_t resolution(uint32_t adc, uint8_t osrs, uint8_t filter)
+{
+	if (filter) {
+		return adc;
+	}
+	uint8_t drop = 5 - ((osrs > 5 ? 5 : osrs) - 1) - 1;
+	uint32_t step = 1UL << drop;
+	adc = (adc + step / 2) & ~(step - 1);
+	return (adc > ADC_MAX_20) ? (ADC_MAX_20 & ~(step - 1)) : adc;
+}
+
+static uint32_t iir(uint32_t &state, uint32_t adc, uint8_t filter, bool first)
+{
+	uint32_t coefficient = 1UL << (filter > 4 ? 4 : filter);
+	if (first || coefficient == 1) {
+		state = adc;
+	}
+	else {
+		state = (state * (coefficient - 1) + adc) / coefficient;
+	}
+	return state;
+}
+
+static void putWord(uint8_t *regs, uint8_t address, uint16_t value)
+{
+	regs[address] = value & 0xFF;
+	regs[address + 1] = value >> 8;
+}
+
+static void putAdc20(uint8_t *regs, uint8_t address, uint32_t adc)
+{
+	regs[address] = (adc >> 12) & 0xFF;
+	regs[address + 1] = (adc >> 4) & 0xFF;
+	regs[address + 2] = (adc << 4) & 0xF0;
+}
+
+BME280Model::BME280Model(const SimEnvironment &env)
+	: _env(env), _conversions(0)
+{
+	reset(0);
+}
+
+//the power on state, with the NVM copy running for its first 2 ms
+void BME280Model::reset(uint64_t now)
+{
+	memset(_regs, 0, sizeof(_regs));
+	_regs[REG_ID] = BME280_MODEL_ID;
+
+	uint8_t *calib = &_regs[REG_CALIB_00];
+	putWord(calib, 0, digT1);
+	putWord(calib, 2, digT2);
+	putWord(calib, 4, digT3);
+	putWord(calib, 6, digP1);
+	putWord(calib, 8, digP2);
+	putWord(calib, 10, digP3);
+	putWord(calib, 12, digP4);
+	putWord(calib, 14, digP5);
+	putWord(calib, 16, digP6);
+	putWord(calib, 18, digP7);
+	putWord(calib, 20, digP8);
+	putWord(calib, 22, digP9);
+	calib[25] = digH1;
+	calib = &_regs[REG_CALIB_26];
+	putWord(calib, 0, digH2);
+	calib[2] = digH3;
+	calib[3] = (digH4 >> 4) & 0xFF;
+	calib[4] = (digH4 & 0x0F) | ((digH5 & 0x0F) << 4);
+	calib[5] = (digH5 >> 4) & 0xFF;
+	calib[6] = digH6;
+
+	putAdc20(_regs, REG_PRESS_MSB, ADC_SKIPPED_20);
+	putAdc20(_regs, REG_TEMP_MSB, ADC_SKIPPED_20);
+	_regs[REG_HUM_MSB] = ADC_SKIPPED_16 >> 8;
+
+	_address = 0;
+	_osrsH = 0;
+	_converting = false;
+	_conversionEnd = 0;
+	_copyEnd = now + NVM_COPY_US;
+	_filterT = 0;
+	_filterP = 0;
+	_filtered = false;
+	_regs[REG_STATUS] = STATUS_IM_UPDATE;
+}
+
+//typical times from the datasheet
+uint32_t BME280Model::measureTime(void) const
+{
+	uint8_t meas = _regs[REG_CTRL_MEAS];
+	uint8_t t = oversampling(meas >> 5);
+	uint8_t p = oversampling((meas >> 2) & 0x07);
+	uint8_t h = oversampling(_osrsH);
+	uint32_t us = 1000 + 2000UL * t;
+	if (p) {
+		us += 2000UL * p + 500;
+	}
+	if (h) {
+		us += 2000UL * h + 500;
+	}
+	return us;
+}
+
+uint32_t BME280Model::standbyTime(void) const
+{
+	return standbyUs[_regs[REG_CONFIG] >> 5];
+}
+
+void BME280Model::update(uint64_t now)
+{
+	if (_converting && now >= _conversionEnd)
+	{
+		if ((_regs[REG_CTRL_MEAS] & MODE_MASK) == MODE_NORMAL)
+		{
+			uint64_t period = measureTime() + standbyTime();
+			uint64_t n = (now - _conversionEnd) / period + 1;
+			for (uint64_t i = 0; i < n && i < CONVERSIONS_MAX; i++) {
+				convert();
+			}
+			_conversionEnd += n * period;
+		}
+		else
+		{
+			// forced mode goes back to sleep by itself
+			convert();
+			_converting = false;
+			_regs[REG_CTRL_MEAS] &= (uint8_t)~MODE_MASK;
+		}
+	}
+	uint8_t status = 0;
+	if (_converting && now + measureTime() >= _conversionEnd) {
+		status |= STATUS_MEASURING;
+	}
+	if (now < _copyEnd) {
+		status |= STATUS_IM_UPDATE;
+	}
+	_regs[REG_STATUS] = status;
+}
+
+void BME280Model::convert(void)
+{
+	uint8_t meas = _regs[REG_CTRL_MEAS];
+	uint8_t osrsT = meas >> 5;
+	uint8_t osrsP = (meas >> 2) & 0x07;
+	uint8_t filter = (_regs[REG_CONFIG] >> 2) & 0x07;
+	uint32_t adcT = ADC_SKIPPED_20;
+	uint32_t adcP = ADC_SKIPPED_20;
+	uint32_t adcH = ADC_SKIPPED_16;
+
+	if (osrsT) {
+		adcT = iir(_filterT, resolution(rawTemperature(_env.temperature), osrsT, filter), filter, !_filtered);
+	}
+	// pressure and humidity compensate against the temperature just read
+	int32_t tFine;
+	compensateT(adcT, tFine);
+	if (osrsP) {
+		adcP = iir(_filterP, resolution(rawPressure(_env.pressure, tFine), osrsP, filter), filter, !_filtered);
+	}
+	if (_osrsH) {
+		adcH = rawHumidity(_env.humidity, tFine);
+	}
+	_filtered = true;
+	_conversions++;
+
+	putAdc20(_regs, REG_PRESS_MSB, adcP);
+	putAdc20(_regs, REG_TEMP_MSB, adcT);
+	_regs[REG_HUM_MSB] = adcH >> 8;
+	_regs[REG_HUM_MSB + 1] = adcH & 0xFF;
+}
+
+void BME280Model::writeRegister(uint8_t address, uint8_t value, uint64_t now)
+{
+	switch (address)
+	{
+		case REG_RESET:
+			if (value == RESET_WORD) {
+				reset(now);
+			}
+			break;
+		case REG_CTRL_HUM:
+			_regs[REG_CTRL_HUM] = value & 0x07;
+			break;
+		case REG_CTRL_MEAS:
+		{
+			uint8_t was = _regs[REG_CTRL_MEAS] & MODE_MASK;
+			_regs[REG_CTRL_MEAS] = value;
+			_osrsH = _regs[REG_CTRL_HUM];
+			uint8_t mode = value & MODE_MASK;
+			if (mode == MODE_SLEEP) {
+				_converting = false;
+			}
+			else if (mode != MODE_NORMAL || was != MODE_NORMAL) {
+				_converting = true;
+				_conversionEnd = now + measureTime();
+			}
+			break;
+		}
+		case REG_CONFIG:
+			if ((_regs[REG_CTRL_MEAS] & MODE_MASK) == MODE_SLEEP) {
+				_regs[REG_CONFIG] = value & 0xFD;
+			}
+			break;
+		default:
+			// everything else is read only
+			break;
+	}
+}
+
+bool BME280Model::write(const uint8_t *data, uint8_t length)
+{
+	if (length == 0) {
+		return true;
+	}
+	uint64_t now = nativeMicros();
+	_address = data[0];
+	for (uint8_t i = 0; i + 1 < length; i += 2) {
+		writeRegister(data[i], data[i + 1], now);
+	}
+	update(now);
+	return true;
+}
+
+uint8_t BME280Model::read(uint8_t *data, uint8_t length)
+{
+	for (uint8_t i = 0; i < length; i++) {
+		data[i] = _regs[_address++];
+	}
+	return length;
+}
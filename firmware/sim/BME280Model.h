@@ -0,0 +1,62 @@
+/*
+ * BME280Model.h - BME280 humidity, pressure and temperature sensor on the
+ * simulated I2C bus
+ *
+ * The register file runs from 0x88 to 0xFE. A write is a register address
+ * and then address, value pairs; a read starts at the last address written
+ * and counts up. The calibration block holds fixed trimming constants and
+ * the data registers hold the raw ADC words that give back the environment
+ * values through the datasheet compensation, at the resolution the
+ * oversampling and filter settings allow.
+ *
+ * Conversions take the datasheet's typical measurement time. In normal
+ * mode they repeat every measurement plus standby time, forced mode runs
+ * one and goes back to sleep. status.measuring is set while one runs and
+ * the data registers change when it ends. ctrl_hum only takes effect on
+ * the next write to ctrl_meas, and config is ignored outside sleep mode,
+ * both as the datasheet warns.
+ */
+
+#ifndef _BME280_MODEL_H_
+#define _BME280_MODEL_H_
+
+#include "SimDevice.h"
+#include "SimEnvironment.h"
+
+#define BME280_MODEL_ID					0x60
+
+class BME280Model : public SimDevice
+{
+public:
+	explicit BME280Model(const SimEnvironment &env);
+
+	void update(uint64_t now);
+
+	uint8_t reg(uint8_t address) const { return _regs[address]; }
+	uint32_t conversions() const { return _conversions; }
+
+protected:
+	bool write(const uint8_t *data, uint8_t length);
+	uint8_t read(uint8_t *data, uint8_t length);
+
+private:
+	void reset(uint64_t now);
+	void writeRegister(uint8_t address, uint8_t value, uint64_t now);
+	void convert(void);
+	uint32_t measureTime(void) const;
+	uint32_t standbyTime(void) const;
+
+	const SimEnvironment &_env;
+	uint8_t _regs[256];
+	uint8_t _address;
+	uint8_t _osrsH;						//ctrl_hum as of the last ctrl_meas write
+	bool _converting;
+	uint64_t _conversionEnd;	//us
+	uint64_t _copyEnd;				//us, NVM copy after reset
+	uint32_t _filterT;				//IIR state, 20 bit
+	uint32_t _filterP;
+	bool _filtered;
+	uint32_t _conversions;
+};
+
+#endif
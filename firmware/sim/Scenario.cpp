@@ -0,0 +1,167 @@
+/*
+ * Scenario.cpp - timed script for the simulator
+ */
+
+#include "Scenario.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <fstream>
+#include <sstream>
+
+bool scenarioTime(const std::string &token, uint64_t &us)
+{
+	char *end;
+	double value = strtod(token.c_str(), &end);
+	std::string unit(end);
+	double scale;
+	if (unit.empty() || unit == "s") {
+		scale = 1e6;
+	}
+	else if (unit == "us") {
+		scale = 1;
+	}
+	else if (unit == "ms") {
+		scale = 1e3;
+	}
+	else if (unit == "m") {
+		scale = 60e6;
+	}
+	else if (unit == "h") {
+		scale = 3600e6;
+	}
+	else {
+		return false;
+	}
+	if (end == token.c_str() || value < 0) {
+		return false;
+	}
+	us = (uint64_t)(value * scale + 0.5);
+	return true;
+}
+
+static std::string unescape(const std::string &text)
+{
+	std::string out;
+	for (size_t i = 0; i < text.size(); i++)
+	{
+		if (text[i] != '\\' || i + 1 == text.size()) {
+			out += text[i];
+			continue;
+		}
+		switch (text[++i])
+		{
+			case 'n': out += '\n'; break;
+			case 'r': out += '\r'; break;
+			case 't': out += '\t'; break;
+			case 'x':
+				//two hex digits, for binary arguments
+				if (i + 2 < text.size() && isxdigit((unsigned char)text[i + 1]) && isxdigit((unsigned char)text[i + 2]))
+				{
+					out += (char)strtol(text.substr(i + 1, 2).c_str(), NULL, 16);
+					i += 2;
+					break;
+				}
+				out += text[i];
+				break;
+			default: out += text[i]; break;
+		}
+	}
+	return out;
+}
+
+static std::string rest(std::istringstream &in)
+{
+	std::string text;
+	std::getline(in >> std::ws, text);
+	return unescape(text);
+}
+
+bool Scenario::load(const char *path, std::string &error)
+{
+	std::ifstream file(path);
+	if (!file) {
+		error = std::string("cannot open ") + path;
+		return false;
+	}
+	events.clear();
+	end = 0;
+	bool ended = false;
+	uint64_t last = 0;
+	std::string line;
+	for (unsigned number = 1; std::getline(file, line); number++)
+	{
+		std::istringstream in(line);
+		std::string token;
+		if (!(in >> token) || token[0] == '#') {
+			continue;
+		}
+		char where[32];
+		snprintf(where, sizeof(where), "line %u: ", number);
+		bool relative = (token[0] == '+');
+		uint64_t time;
+		if (!scenarioTime(relative ? token.substr(1) : token, time)) {
+			error = where + std::string("bad time ") + token;
+			return false;
+		}
+		if (relative) {
+			time += last;
+		}
+		if (time < last) {
+			error = where + std::string("time goes backwards");
+			return false;
+		}
+		last = time;
+
+		ScenarioEvent event;
+		event.time = time;
+		event.value = 0;
+		event.line = number;
+		std::string action;
+		in >> action;
+		if (action == "send") {
+			event.action = SCENARIO_SEND;
+			event.text = rest(in);
+		}
+		else if (action == "set") {
+			event.action = SCENARIO_SET;
+			if (!(in >> event.name >> event.value)) {
+				error = where + std::string("set needs a name and a value");
+				return false;
+			}
+		}
+		else if (action == "expect") {
+			event.action = SCENARIO_EXPECT;
+			event.text = rest(in);
+		}
+		else if (action == "reject") {
+			event.action = SCENARIO_REJECT;
+			event.text = rest(in);
+		}
+		else if (action == "fault") {
+			event.action = SCENARIO_FAULT;
+			if (!(in >> event.name >> event.text)) {
+				error = where + std::string("fault needs a device and a kind");
+				return false;
+			}
+			if (!(in >> event.value)) {
+				event.value = 1;
+			}
+		}
+		else if (action == "end") {
+			event.action = SCENARIO_END;
+			ended = true;
+		}
+		else {
+			error = where + std::string("unknown action ") + action;
+			return false;
+		}
+		events.push_back(event);
+		end = time;
+		if (ended) {
+			break;
+		}
+	}
+	return true;
+}
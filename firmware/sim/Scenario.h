@@ -0,0 +1,65 @@
+/*
+ * Scenario.h - timed script for the simulator
+ *
+ * One event per line, a time and then an action:
+ *
+ *   # comment
+ *   0        set lux 300
+ *   1s       send 47;\n
+ *   +500ms   expect 48,300
+ *   12h      set lux 0.5
+ *   24h      end
+ *
+ * Times are absolute, or relative to the previous event with a leading +,
+ * and take a us, ms, s, m or h suffix (seconds without one).
+ *
+ *   send TEXT        queue TEXT on the serial input, \n \r \t \\ escaped,
+ *                    and any byte as \xHH
+ *   set NAME VALUE   change the environment, see SimEnvironment
+ *   expect TEXT      fail unless TEXT was sent since the last expect
+ *   reject TEXT      fail if TEXT was sent since the last expect or reject
+ *   fault DEVICE KIND [COUNT]
+ *                    inject a fault, see SimDevice.h; DEVICE is bme280 or
+ *                    vcnl4040, or bus with KIND stuck or free
+ *   end              stop here; otherwise the run stops at the last event
+ */
+
+#ifndef _SIM_SCENARIO_H_
+#define _SIM_SCENARIO_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+enum ScenarioAction
+{
+	SCENARIO_SEND,
+	SCENARIO_SET,
+	SCENARIO_EXPECT,
+	SCENARIO_REJECT,
+	SCENARIO_FAULT,
+	SCENARIO_END
+};
+
+struct ScenarioEvent
+{
+	uint64_t time;				//us
+	ScenarioAction action;
+	std::string name;			//set, fault device
+	std::string text;			//send, expect, reject, fault kind
+	double value;					//set, fault count
+	unsigned line;
+};
+
+struct Scenario
+{
+	std::vector<ScenarioEvent> events;
+	uint64_t end;					//us
+
+	// Returns false and fills error on the first bad line
+	bool load(const char *path, std::string &error);
+};
+
+bool scenarioTime(const std::string &token, uint64_t &us);
+
+#endif
@@ -0,0 +1,71 @@
+/*
+ * SimDevice.cpp - common part of the device models on the simulated I2C bus
+ */
+
+#include "SimDevice.h"
+
+#include <string.h>
+
+#include "NativeHost.h"
+
+bool SimDevice::nack(void)
+{
+	if (_off) {
+		_faults++;
+		return true;
+	}
+	if (_nacks > 0) {
+		_nacks--;
+		_faults++;
+		return true;
+	}
+	return false;
+}
+
+bool SimDevice::i2cWrite(const uint8_t *data, uint8_t length)
+{
+	if (nack()) {
+		return false;
+	}
+	_writes++;
+	update(nativeMicros());
+	return write(data, length);
+}
+
+uint8_t SimDevice::i2cRead(uint8_t *data, uint8_t length)
+{
+	if (nack()) {
+		return 0;
+	}
+	_reads++;
+	update(nativeMicros());
+	uint8_t n = read(data, length);
+	if (_shorts > 0 && n > 0) {
+		_shorts--;
+		_faults++;
+		n--;
+	}
+	return n;
+}
+
+bool SimDevice::fault(const char *kind, unsigned count)
+{
+	if (strcmp(kind, "nack") == 0) {
+		_nacks += count;
+	}
+	else if (strcmp(kind, "short") == 0) {
+		_shorts += count;
+	}
+	else if (strcmp(kind, "off") == 0) {
+		_off = true;
+	}
+	else if (strcmp(kind, "on") == 0) {
+		_off = false;
+		_nacks = 0;
+		_shorts = 0;
+	}
+	else {
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,59 @@
+/*
+ * SimDevice.h - common part of the device models on the simulated I2C bus
+ *
+ * Counts the transactions each model sees and injects faults in front of
+ * it, so the firmware can be run against a misbehaving sensor:
+ *
+ *   nack N     NACK the next N transactions, reads and writes alike
+ *   short N    end the next N reads one byte early
+ *   off        NACK everything, as if the part were not fitted
+ *   on         undo off and drop any faults still queued
+ *
+ * A model works out what happened since it was last touched when it is
+ * next written, read or updated, from nativeMicros().
+ */
+
+#ifndef _SIM_DEVICE_H_
+#define _SIM_DEVICE_H_
+
+#include <stdint.h>
+#include <Wire.h>
+
+class SimDevice : public I2CDevice
+{
+public:
+	SimDevice() : _nacks(0), _shorts(0), _off(false), _writes(0), _reads(0), _faults(0) {}
+
+	bool i2cWrite(const uint8_t *data, uint8_t length);
+	uint8_t i2cRead(uint8_t *data, uint8_t length);
+
+	// false for a kind not listed above
+	bool fault(const char *kind, unsigned count);
+
+	// Bring the model up to now. The simulator calls this between passes so
+	// the INT output follows the conversions even while nothing is read.
+	virtual void update(uint64_t now) = 0;
+	// true while the INT output is asserted
+	virtual bool interrupt(void) const { return false; }
+
+	uint32_t writes() const { return _writes; }
+	uint32_t reads() const { return _reads; }
+	uint32_t faults() const { return _faults; }
+
+protected:
+	// the transaction once it got past the faults; same contract as I2CDevice
+	virtual bool write(const uint8_t *data, uint8_t length) = 0;
+	virtual uint8_t read(uint8_t *data, uint8_t length) = 0;
+
+private:
+	bool nack(void);
+
+	unsigned _nacks;
+	unsigned _shorts;
+	bool _off;
+	uint32_t _writes;
+	uint32_t _reads;
+	uint32_t _faults;
+};
+
+#endif
@@ -0,0 +1,28 @@
+/*
+ * SimEnvironment.cpp - the physical world around the simulated SensorHub
+ */
+
+#include "SimEnvironment.h"
+
+#include <string.h>
+
+bool SimEnvironment::set(const char *name, double value)
+{
+	struct Field { const char *name; double SimEnvironment::*field; };
+	static const Field fields[] = {
+		{"lux", &SimEnvironment::lux},
+		{"white", &SimEnvironment::whiteRatio},
+		{"ps", &SimEnvironment::proximity},
+		{"temperature", &SimEnvironment::temperature},
+		{"humidity", &SimEnvironment::humidity},
+		{"pressure", &SimEnvironment::pressure},
+	};
+	for (const Field &f : fields)
+	{
+		if (strcmp(name, f.name) == 0) {
+			this->*f.field = value;
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,29 @@
+/*
+ * SimEnvironment.h - the physical world around the simulated SensorHub
+ *
+ * Scenario files set these values and the device models turn them into
+ * register contents, so the firmware sees them through its own drivers.
+ */
+
+#ifndef _SIM_ENVIRONMENT_H_
+#define _SIM_ENVIRONMENT_H_
+
+struct SimEnvironment
+{
+	double lux;						//illuminance at the ALS
+	double whiteRatio;		//WHITE over ALS response, about 1 for LED light
+	double proximity;			//PS counts before cancellation
+	double temperature;		//degrees C
+	double humidity;			//%RH
+	double pressure;			//Pa
+
+	SimEnvironment()
+		: lux(200), whiteRatio(1.0), proximity(10), temperature(21), humidity(45), pressure(101325)
+	{
+	}
+
+	// false if name is not one of the fields above
+	bool set(const char *name, double value);
+};
+
+#endif
@@ -0,0 +1,242 @@
+/*
+ * VCNL4040Model.cpp - VCNL4040 ambient light and proximity sensor on the
+ * simulated I2C bus
+ */
+
+#include "VCNL4040Model.h"
+
+#include <stdint.h>
+
+#include "NativeHost.h"
+
+#define ALS_SD						0x0001		// ALS_CONF, shut down
+#define ALS_INT_EN				0x0002
+#define ALS_PERS_SHIFT		2
+#define ALS_IT_SHIFT			6
+#define PS_SD							0x0001		// PS_CONF1, shut down
+#define PS_IT_SHIFT				1
+#define PS_PERS_SHIFT			4
+#define PS_DUTY_SHIFT			6
+#define PS_INT_CLOSE			0x0100		// PS_CONF2
+#define PS_INT_AWAY				0x0200
+#define PS_HD							0x0800		// PS_CONF2, 16 bit output
+#define PS_TRIG						0x0004		// PS_CONF3, one conversion in active force mode
+#define PS_AF							0x0008		// PS_CONF3, active force mode
+
+#define PS_IF_AWAY				0x0100		// INT_FLAG
+#define PS_IF_CLOSE				0x0200
+#define ALS_IF_H					0x2000
+#define ALS_IF_L					0x4000
+
+#define REG_ALS_CONF			0x00
+#define REG_ALS_THDH			0x01
+#define REG_ALS_THDL			0x02
+#define REG_PS_CONF_1_2		0x03
+#define REG_PS_CONF_3_MS	0x04
+#define REG_PS_CANC				0x05
+#define REG_PS_THDL				0x06
+#define REG_PS_THDH				0x07
+#define REG_PS_DATA				0x08
+#define REG_ALS_DATA			0x09
+#define REG_WHITE_DATA		0x0A
+#define REG_INT_FLAG			0x0B
+#define REG_ID						0x0C
+
+#define ALS_IT_US					80000UL		// at ALS_IT 0
+#define PS_T_HALF_US			62.5			// PS_IT counts in half T
+// a long idle stretch only needs enough conversions to cover the persistence
+#define CONVERSIONS_MAX		16
+
+static const uint8_t psItHalfT[8] = {2, 3, 4, 5, 6, 7, 8, 16};
+
+static uint16_t saturate(double value, double max)
+{
+	if (value <= 0) {
+		return 0;
+	}
+	return (value >= max) ? (uint16_t)max : (uint16_t)(value + 0.5);
+}
+
+//counts conversions in a row that pass a threshold; true on the one that
+//reaches the persistence
+static bool persist(uint8_t &count, bool past, uint8_t persistence)
+{
+	if (!past) {
+		count = 0;
+		return false;
+	}
+	if (count < persistence) {
+		count++;
+		return count == persistence;
+	}
+	return false;
+}
+
+//power on defaults from the datasheet: both channels shut down
+VCNL4040Model::VCNL4040Model(const SimEnvironment &env)
+	: _env(env), _command(0), _alsOn(false), _psOn(false), _alsNext(0), _psNext(0),
+	_alsHigh(0), _alsLow(0), _psHigh(0), _psLow(0), _psClose(false), _alsConversions(0), _psConversions(0)
+{
+	for (uint8_t i = 0; i < VCNL4040_MODEL_REGS; i++) {
+		_regs[i] = 0;
+	}
+	_regs[REG_ALS_CONF] = ALS_SD;
+	_regs[REG_PS_CONF_1_2] = PS_SD;
+	_regs[REG_ID] = VCNL4040_MODEL_ID;
+}
+
+uint32_t VCNL4040Model::alsPeriod(void) const
+{
+	return ALS_IT_US << ((_regs[REG_ALS_CONF] >> ALS_IT_SHIFT) & 0x03);
+}
+
+//the LED is on for one integration time in each duty cycle of 40 to 320
+uint32_t VCNL4040Model::psPeriod(void) const
+{
+	uint16_t conf = _regs[REG_PS_CONF_1_2];
+	uint32_t it = psItHalfT[(conf >> PS_IT_SHIFT) & 0x07] * PS_T_HALF_US;
+	if (_regs[REG_PS_CONF_3_MS] & PS_AF) {
+		return it;
+	}
+	return it * (40UL << ((conf >> PS_DUTY_SHIFT) & 0x03));
+}
+
+//a count is 0.1 lux at the 80 ms integration time and halves with each
+//doubling of it
+void VCNL4040Model::convertALS(void)
+{
+	uint16_t conf = _regs[REG_ALS_CONF];
+	uint8_t range = (conf >> ALS_IT_SHIFT) & 0x03;
+	double counts = _env.lux * 10 * (1 << range);
+	uint16_t als = saturate(counts, 0xFFFF);
+	_regs[REG_ALS_DATA] = als;
+	_regs[REG_WHITE_DATA] = saturate(counts * _env.whiteRatio, 0xFFFF);
+	_alsConversions++;
+
+	uint8_t persistence = 1 << ((conf >> ALS_PERS_SHIFT) & 0x03);
+	bool high = persist(_alsHigh, als > _regs[REG_ALS_THDH], persistence);
+	bool low = persist(_alsLow, als < _regs[REG_ALS_THDL], persistence);
+	if (conf & ALS_INT_EN) {
+		if (high) {
+			_regs[REG_INT_FLAG] |= ALS_IF_H;
+		}
+		if (low) {
+			_regs[REG_INT_FLAG] |= ALS_IF_L;
+		}
+	}
+}
+
+void VCNL4040Model::convertPS(void)
+{
+	uint16_t conf = _regs[REG_PS_CONF_1_2];
+	double max = (conf & PS_HD) ? 0xFFFF : 0x0FFF;
+	uint16_t ps = saturate(_env.proximity - _regs[REG_PS_CANC], max);
+	_regs[REG_PS_DATA] = ps;
+	_psConversions++;
+
+	uint8_t persistence = ((conf >> PS_PERS_SHIFT) & 0x03) + 1;
+	if (!_psClose && persist(_psHigh, ps > _regs[REG_PS_THDH], persistence)) {
+		_psClose = true;
+		_psLow = 0;
+		if (conf & PS_INT_CLOSE) {
+			_regs[REG_INT_FLAG] |= PS_IF_CLOSE;
+		}
+	}
+	else if (_psClose && persist(_psLow, ps < _regs[REG_PS_THDL], persistence)) {
+		_psClose = false;
+		_psHigh = 0;
+		if (conf & PS_INT_AWAY) {
+			_regs[REG_INT_FLAG] |= PS_IF_AWAY;
+		}
+	}
+}
+
+void VCNL4040Model::update(uint64_t now)
+{
+	if (_alsOn && now >= _alsNext)
+	{
+		uint64_t n = (now - _alsNext) / alsPeriod() + 1;
+		for (uint64_t i = 0; i < n && i < CONVERSIONS_MAX; i++) {
+			convertALS();
+		}
+		_alsNext += n * alsPeriod();
+	}
+	if (_psOn && now >= _psNext)
+	{
+		if (_regs[REG_PS_CONF_3_MS] & PS_AF)
+		{
+			// one conversion per trigger, then the bit clears itself
+			if (_regs[REG_PS_CONF_3_MS] & PS_TRIG) {
+				convertPS();
+				_regs[REG_PS_CONF_3_MS] &= (uint16_t)~PS_TRIG;
+			}
+			_psNext = UINT64_MAX;
+		}
+		else
+		{
+			uint64_t n = (now - _psNext) / psPeriod() + 1;
+			for (uint64_t i = 0; i < n && i < CONVERSIONS_MAX; i++) {
+				convertPS();
+			}
+			_psNext += n * psPeriod();
+		}
+	}
+}
+
+//powering a channel up or changing its timing starts a new conversion
+void VCNL4040Model::configure(uint8_t code, uint16_t value, uint64_t now)
+{
+	uint16_t was = _regs[code];
+	_regs[code] = value;
+	switch (code)
+	{
+		case REG_ALS_CONF:
+			_alsOn = !(value & ALS_SD);
+			if (_alsOn && ((was & ALS_SD) || ((was ^ value) >> ALS_IT_SHIFT) & 0x03)) {
+				_alsNext = now + alsPeriod();
+			}
+			break;
+		case REG_PS_CONF_1_2:
+			_psOn = !(value & PS_SD);
+			if (_psOn && ((was & PS_SD) || ((was ^ value) & 0x00FE))) {
+				_psNext = (_regs[REG_PS_CONF_3_MS] & PS_AF) ? UINT64_MAX : now + psPeriod();
+			}
+			break;
+		case REG_PS_CONF_3_MS:
+			if ((value & PS_AF) && (value & PS_TRIG)) {
+				_psNext = now + psPeriod();
+			}
+			else if ((was & PS_AF) && !(value & PS_AF)) {
+				_psNext = now + psPeriod();
+			}
+			break;
+		default:
+			break;
+	}
+}
+
+//a write is the command code, then LSB and MSB; the code alone sets up a read
+bool VCNL4040Model::write(const uint8_t *data, uint8_t length)
+{
+	if (length == 0) {
+		return true;
+	}
+	_command = data[0];
+	if (length >= 3 && _command < REG_PS_DATA) {
+		configure(_command, data[1] | ((uint16_t)data[2] << 8), nativeMicros());
+	}
+	return true;
+}
+
+//reading INT_FLAG clears it
+uint8_t VCNL4040Model::read(uint8_t *data, uint8_t length)
+{
+	uint16_t value = reg(_command);
+	for (uint8_t i = 0; i < length; i++) {
+		data[i] = (i & 1) ? (value >> 8) : (value & 0xFF);
+	}
+	if (_command == REG_INT_FLAG && length > 0) {
+		_regs[REG_INT_FLAG] = 0;
+	}
+	return length;
+}
@@ -0,0 +1,70 @@
+/*
+ * VCNL4040Model.h - VCNL4040 ambient light and proximity sensor on the
+ * simulated I2C bus
+ *
+ * Command codes 0x00 to 0x07 are read/write, 0x08 to 0x0C read only. Every
+ * register is 16 bits, sent LSB first.
+ *
+ * Each channel converts on its own period once it is powered up: ALS every
+ * integration time, 80 ms to 640 ms, and PS every duty cycle times its
+ * integration time, or once per PS_TRIG in active force mode. A conversion
+ * fills the data register from the environment, ALS at the resolution of
+ * the integration time, WHITE from the white ratio and PS less the
+ * cancellation level. Until the first one ends after power up the register
+ * keeps what it had, zero from reset.
+ *
+ * Conversions are checked against the thresholds with the configured
+ * persistence. A crossing sets its bit in INT_FLAG, which a read clears,
+ * and holds the INT output asserted while any bit is set. PS uses the
+ * normal close and away hysteresis, not the logic output mode.
+ */
+
+#ifndef _VCNL4040_MODEL_H_
+#define _VCNL4040_MODEL_H_
+
+#include "SimDevice.h"
+#include "SimEnvironment.h"
+
+#define VCNL4040_MODEL_REGS			0x0D
+#define VCNL4040_MODEL_ID				0x0186
+
+class VCNL4040Model : public SimDevice
+{
+public:
+	explicit VCNL4040Model(const SimEnvironment &env);
+
+	void update(uint64_t now);
+	bool interrupt(void) const { return _regs[0x0B] != 0; }
+
+	uint16_t reg(uint8_t code) const { return (code < VCNL4040_MODEL_REGS) ? _regs[code] : 0; }
+	uint32_t alsConversions() const { return _alsConversions; }
+	uint32_t psConversions() const { return _psConversions; }
+
+protected:
+	bool write(const uint8_t *data, uint8_t length);
+	uint8_t read(uint8_t *data, uint8_t length);
+
+private:
+	void configure(uint8_t code, uint16_t value, uint64_t now);
+	uint32_t alsPeriod(void) const;
+	uint32_t psPeriod(void) const;
+	void convertALS(void);
+	void convertPS(void);
+
+	const SimEnvironment &_env;
+	uint16_t _regs[VCNL4040_MODEL_REGS];
+	uint8_t _command;
+	bool _alsOn;
+	bool _psOn;
+	uint64_t _alsNext;			//us, end of the conversion running
+	uint64_t _psNext;
+	uint8_t _alsHigh;				//conversions in a row past each threshold
+	uint8_t _alsLow;
+	uint8_t _psHigh;
+	uint8_t _psLow;
+	bool _psClose;
+	uint32_t _alsConversions;
+	uint32_t _psConversions;
+};
+
+#endif
@@ -0,0 +1,31 @@
+#!/bin/sh
+#
+# check.sh - run every scenario and report which failed
+#
+#   pio run -e sim && sim/check.sh [program]
+#
+# Each scenario starts from an erased EEPROM. The transcripts are left in
+# the build directory next to the program as <scenario>.log. The exit
+# status is 1 if any scenario failed.
+
+program=${1:-.pio/build/sim/program}
+dir=$(dirname "$0")/scenarios
+
+if [ ! -x "$program" ]; then
+	echo "check.sh: no $program, build it with: pio run -e sim" >&2
+	exit 2
+fi
+
+logs=$(dirname "$program")
+failed=0
+for scenario in "$dir"/*.txt
+do
+	name=$(basename "$scenario" .txt)
+	if env -u SENSORHUB_EEPROM "$program" -o "$logs/$name.log" "$scenario" >/dev/null 2>&1; then
+		echo "pass  $name"
+	else
+		echo "FAIL  $name, see $logs/$name.log"
+		failed=1
+	fi
+done
+exit $failed
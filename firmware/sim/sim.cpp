@@ -0,0 +1,318 @@
+/*
+ * sim.cpp - virtual time simulator for the SensorHub firmware
+ *
+ *   sim [-o transcript.txt] [-r capture.bin] [-l loop_us] [-i pin] scenario.txt
+ *
+ * Runs the unmodified firmware on the virtual clock. Timer2 still drives
+ * sysTaskTimer every SYS_TICK_PERIOD of virtual time, and I2C transfers,
+ * EEPROM writes and delay() take their device time. A pass of loop() costs
+ * loop_us on top. When a pass does nothing at all, with no interrupt, bus,
+ * serial or EEPROM activity, the clock skips straight to the next event, so
+ * a day of device time runs in seconds.
+ *
+ * The BME280 and VCNL4040 are register level models (BME280Model.h,
+ * VCNL4040Model.h) behind the firmware's own drivers, and the scenario can
+ * make them or the bus misbehave. The VCNL4040 INT output is not wired on
+ * SensorHub_R2; -i connects it to a pin, where attachInterrupt() sees it.
+ *
+ * The scenario feeds serial input and sensor values in at set times (see
+ * Scenario.h). Everything the firmware sends is written to the transcript,
+ * one line per line of output, stamped with the virtual time in seconds.
+ * -r also writes it byte for byte, for tests that need the frames exactly
+ * as the firmware escaped them.
+ * The summary on stderr counts the bus transactions each device saw. The
+ * exit status is 1 if any expect or reject in the scenario failed.
+ */
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <string>
+
+#include "BME280Model.h"
+#include "NativeHost.h"
+#include "Scenario.h"
+#include "SimEnvironment.h"
+#include "VCNL4040Model.h"
+
+#define SIM_LOOP_US					100		// CPU time of one pass of loop() outside the bus, us
+#define SIM_VCNL4040_ADDR		0x60
+#define SIM_BME280_ADDR			0x76
+#define SIM_DEVICES					2
+
+struct SimBusDevice
+{
+	const char *name;
+	uint8_t address;
+	SimDevice *device;
+};
+
+struct SimTranscript
+{
+	FILE *file;
+	std::string output;		//everything sent, for expect and reject
+	size_t checked;				//output before this was matched or checked already
+	std::string line;
+};
+
+static void drain(SimTranscript &transcript)
+{
+	char buffer[256];
+	size_t n;
+	while ((n = Serial.take(buffer, sizeof(buffer))) > 0)
+	{
+		transcript.output.append(buffer, n);
+		if (transcript.file == NULL) {
+			continue;
+		}
+		for (size_t i = 0; i < n; i++)
+		{
+			if (transcript.line.empty()) {
+				char stamp[32];
+				snprintf(stamp, sizeof(stamp), "%.6f ", nativeMicros() / 1e6);
+				transcript.line = stamp;
+			}
+			if (buffer[i] == '\n') {
+				fprintf(transcript.file, "%s\n", transcript.line.c_str());
+				transcript.line.clear();
+			}
+			else if (buffer[i] != '\r') {
+				transcript.line += buffer[i];
+			}
+		}
+	}
+}
+
+//bus wide faults, or one device's
+static bool fault(SimBusDevice *devices, const ScenarioEvent &event)
+{
+	if (event.name == "bus")
+	{
+		if (event.text != "stuck" && event.text != "free") {
+			return false;
+		}
+		Wire.setStuck(event.text == "stuck");
+		return true;
+	}
+	for (uint8_t i = 0; i < SIM_DEVICES; i++)
+	{
+		if (event.name == devices[i].name) {
+			return devices[i].device->fault(event.text.c_str(), (unsigned)event.value);
+		}
+	}
+	return false;
+}
+
+static double hostSeconds(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void usage(void)
+{
+	fprintf(stderr, "usage: sim [-o transcript.txt] [-r capture.bin] [-l loop_us] [-i pin] scenario.txt\n");
+}
+
+int main(int argc, char **argv)
+{
+	const char *transcriptPath = NULL;
+	const char *capturePath = NULL;
+	uint64_t loopUs = SIM_LOOP_US;
+	int intPin = -1;
+	int opt;
+	while ((opt = getopt(argc, argv, "o:r:l:i:")) != -1)
+	{
+		switch (opt)
+		{
+			case 'o':
+				transcriptPath = optarg;
+				break;
+			case 'r':
+				capturePath = optarg;
+				break;
+			case 'l':
+				loopUs = strtoul(optarg, NULL, 10);
+				break;
+			case 'i':
+				intPin = atoi(optarg);
+				break;
+			default:
+				usage();
+				return 2;
+		}
+	}
+	if (optind + 1 != argc) {
+		usage();
+		return 2;
+	}
+
+	Scenario scenario;
+	std::string error;
+	if (!scenario.load(argv[optind], error)) {
+		fprintf(stderr, "%s: %s\n", argv[optind], error.c_str());
+		return 2;
+	}
+
+	SimTranscript transcript;
+	transcript.file = stdout;
+	transcript.checked = 0;
+	if (transcriptPath != NULL && strcmp(transcriptPath, "-") != 0) {
+		transcript.file = fopen(transcriptPath, "w");
+		if (transcript.file == NULL) {
+			perror(transcriptPath);
+			return 2;
+		}
+	}
+
+	SimEnvironment env;
+	VCNL4040Model vcnl4040(env);
+	BME280Model bme280(env);
+	SimBusDevice devices[SIM_DEVICES] = {
+		{"vcnl4040", SIM_VCNL4040_ADDR, &vcnl4040},
+		{"bme280", SIM_BME280_ADDR, &bme280},
+	};
+	for (uint8_t i = 0; i < SIM_DEVICES; i++) {
+		Wire.attach(devices[i].address, devices[i].device);
+	}
+	if (intPin >= 0) {
+		// open drain, pulled up while released
+		nativeDrivePin(intPin, HIGH);
+	}
+
+	double started = hostSeconds();
+	nativeUseVirtualClock();
+	SREG |= 0x80;
+	setup();
+
+	uint64_t passes = 0;
+	unsigned expects = 0;
+	unsigned missed = 0;
+	unsigned failed = 0;
+	size_t next = 0;
+	for (;;)
+	{
+		uint64_t now = nativeMicros();
+		//conversions up to now use the environment as it was
+		for (uint8_t i = 0; i < SIM_DEVICES; i++) {
+			devices[i].device->update(now);
+		}
+		if (intPin >= 0) {
+			nativeDrivePin(intPin, vcnl4040.interrupt() ? LOW : HIGH);
+		}
+		for (; next < scenario.events.size() && scenario.events[next].time <= now; next++)
+		{
+			const ScenarioEvent &event = scenario.events[next];
+			switch (event.action)
+			{
+				case SCENARIO_SEND:
+					Serial.inject(event.text.data(), event.text.size());
+					break;
+				case SCENARIO_SET:
+					if (!env.set(event.name.c_str(), event.value)) {
+						fprintf(stderr, "line %u: unknown value %s\n", event.line, event.name.c_str());
+						failed++;
+					}
+					break;
+				case SCENARIO_EXPECT:
+				{
+					expects++;
+					drain(transcript);
+					size_t found = transcript.output.find(event.text, transcript.checked);
+					if (found == std::string::npos) {
+						fprintf(stderr, "line %u: expected \"%s\" by %.3f s\n", event.line, event.text.c_str(), now / 1e6);
+						missed++;
+					}
+					else {
+						transcript.checked = found + event.text.size();
+					}
+					break;
+				}
+				case SCENARIO_REJECT:
+				{
+					expects++;
+					drain(transcript);
+					size_t found = transcript.output.find(event.text, transcript.checked);
+					if (found != std::string::npos) {
+						fprintf(stderr, "line %u: \"%s\" was sent at or before %.3f s\n", event.line, event.text.c_str(), now / 1e6);
+						missed++;
+					}
+					//keep the last line end, so text anchored with \n can match the next line
+					transcript.checked = transcript.output.size();
+					if (transcript.checked > 0 && transcript.output[transcript.checked - 1] == '\n') {
+						transcript.checked--;
+					}
+					break;
+				}
+				case SCENARIO_FAULT:
+					if (!fault(devices, event)) {
+						fprintf(stderr, "line %u: unknown fault %s %s\n", event.line, event.name.c_str(), event.text.c_str());
+						failed++;
+					}
+					break;
+				case SCENARIO_END:
+					break;
+			}
+		}
+		if (next == scenario.events.size() && now >= scenario.end) {
+			break;
+		}
+
+		uint32_t activity = nativeActivity();
+		loop();
+		passes++;
+		drain(transcript);
+
+		if (nativeActivity() == activity && !Serial.available())
+		{
+			//nothing to do until the next interrupt or scenario event
+			uint64_t until = nativeNextEvent();
+			uint64_t due = (next < scenario.events.size()) ? scenario.events[next].time : scenario.end;
+			if (due < until) {
+				until = due;
+			}
+			nativeAdvanceTo((until > now) ? until : now + 1);
+		}
+		else {
+			nativeAdvance(loopUs);
+		}
+	}
+	drain(transcript);
+	if (!transcript.line.empty()) {
+		fprintf(transcript.file, "%s\n", transcript.line.c_str());
+	}
+	if (transcript.file != stdout) {
+		fclose(transcript.file);
+	}
+	if (capturePath != NULL)
+	{
+		FILE *capture = fopen(capturePath, "wb");
+		if (capture == NULL || fwrite(transcript.output.data(), 1, transcript.output.size(), capture) != transcript.output.size()) {
+			perror(capturePath);
+			failed++;
+		}
+		if (capture != NULL) {
+			fclose(capture);
+		}
+	}
+
+	uint64_t seconds = nativeMicros() / 1000000;
+	fprintf(stderr, "simulated %u:%02u:%02u in %.2f s, %llu loop passes, %u timer ticks, %u/%u expects passed\n",
+		(unsigned)(seconds / 3600), (unsigned)(seconds / 60 % 60), (unsigned)(seconds % 60),
+		hostSeconds() - started, (unsigned long long)passes, nativeInterrupts(NATIVE_VECT_TIMER2_COMPA),
+		expects - missed, expects);
+	fprintf(stderr, "i2c: %u transactions, %u failed\n", Wire.transactions(), Wire.errors());
+	for (uint8_t i = 0; i < SIM_DEVICES; i++)
+	{
+		SimDevice *device = devices[i].device;
+		fprintf(stderr, "  %-8s 0x%02x: %u writes, %u reads, %u faults injected\n", devices[i].name,
+			devices[i].address, device->writes(), device->reads(), device->faults());
+	}
+	fprintf(stderr, "  conversions: bme280 %u, vcnl4040 als %u ps %u\n", bme280.conversions(),
+		vcnl4040.alsConversions(), vcnl4040.psConversions());
+	return (failed || missed) ? 1 : 0;
+}
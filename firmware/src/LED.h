@@ -4,7 +4,61 @@
 #include <stdint.h>
 #include <avr/pgmspace.h>
 
-extern const uint16_t cie[101] PROGMEM = {
+//CIE 1931 lightness to PWM duty table, generated at compile time.
+//LED_CIE_STEPS entries span 0..100% lightness, each scaled to
+//LED_CIE_BITS bits of duty. cie.value[] lives in PROGMEM.
+
+#ifndef LED_CIE_STEPS
+#define LED_CIE_STEPS		256
+#endif
+#ifndef LED_CIE_BITS
+#define LED_CIE_BITS		16
+#endif
+
+constexpr double cieLuminance(double lightness)
+{
+	return (lightness <= 8.0) ? lightness / 903.3 :
+		((lightness + 16.0) / 116.0) * ((lightness + 16.0) / 116.0) * ((lightness + 16.0) / 116.0);
+}
+
+constexpr uint16_t cieValue(uint16_t index, uint16_t steps, uint8_t bits)
+{
+	return (uint16_t)(cieLuminance(100.0 * index / (steps - 1)) * ((1UL << bits) - 1) + 0.5);
+}
+
+//index sequence built by halving so 1024 entries stay within the
+//compiler's template depth limit
+template <uint16_t... I> struct CieSeq { typedef CieSeq type; };
+
+template <class A, class B> struct CieConcat;
+template <uint16_t... A, uint16_t... B> struct CieConcat<CieSeq<A...>, CieSeq<B...> >
+	: CieSeq<A..., (uint16_t)(sizeof...(A) + B)...> {};
+
+template <uint16_t N> struct CieMakeSeq
+	: CieConcat<typename CieMakeSeq<N / 2>::type, typename CieMakeSeq<N - N / 2>::type> {};
+template <> struct CieMakeSeq<0> : CieSeq<> {};
+template <> struct CieMakeSeq<1> : CieSeq<0> {};
+
+template <uint16_t N> struct CieTable
+{
+	uint16_t value[N];
+};
+
+template <uint16_t N, uint8_t Bits, uint16_t... I>
+constexpr CieTable<N> cieGenerateSeq(CieSeq<I...>)
+{
+	return CieTable<N>{{ cieValue(I, N, Bits)... }};
+}
+
+template <uint16_t N, uint8_t Bits>
+constexpr CieTable<N> cieGenerate()
+{
+	return cieGenerateSeq<N, Bits>(typename CieMakeSeq<N>::type());
+}
+
+//the hand written 101 step, 10 bit table this replaced; only used by the
+//check below, so it takes no flash
+constexpr uint16_t cieOriginal[101] = {
 	0, 1, 2, 3, 5, 6, 7, 8, 9, 10,
 	12, 13, 14, 16, 18, 20, 21, 24, 26, 28,
 	31, 33, 36, 39, 42, 45, 49, 52, 56, 60,
@@ -18,4 +72,13 @@ extern const uint16_t cie[101] PROGMEM = {
 	1023
 };
 
+constexpr bool cieMatchesOriginal(uint16_t index)
+{
+	return index == 101 || (cieValue(index, 101, 10) == cieOriginal[index] && cieMatchesOriginal(index + 1));
+}
+
+static_assert(cieMatchesOriginal(0), "CIE generator disagrees with the original table");
+
+const CieTable<LED_CIE_STEPS> cie PROGMEM = cieGenerate<LED_CIE_STEPS, LED_CIE_BITS>();
+
 #endif
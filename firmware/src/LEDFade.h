@@ -0,0 +1,109 @@
+#ifndef _LED_FADE_H_
+#define _LED_FADE_H_
+
+#include <stdint.h>
+#include <avr/pgmspace.h>
+#include "LED.h"
+
+//Time based fade engine. Brightness is carried as a level in 1/256 of a
+//percent so fades move smoothly between cie.value[] entries. Everything here is
+//a pure function of the time passed in, so it runs the same against
+//millis() on the device or a virtual clock on the host.
+
+#define LED_CURVE_LINEAR				0
+#define LED_CURVE_EASE_IN				1
+#define LED_CURVE_EASE_OUT			2
+#define LED_CURVE_EASE_IN_OUT		3
+#define LED_CURVE_EXPONENTIAL		4
+
+#define LED_LEVEL_MAX						(100 << 8)
+#define LED_LEVEL(percent)			((uint16_t)(percent) << 8)
+
+struct LedFade
+{
+	uint16_t from;
+	uint16_t to;
+	uint16_t duration;		//ms
+	uint8_t curve;
+	uint32_t start;				//ms
+};
+
+//maps linear progress p (0..65535) onto the selected easing curve; p^2 is
+//taken as p(p + 1) so the quadratic curves meet both ends exactly
+uint16_t ledCurve(uint8_t curve, uint16_t p)
+{
+	uint32_t p2 = ((uint32_t)p * p + p) >> 16;
+	switch (curve)
+	{
+		case LED_CURVE_EASE_IN:
+			return p2;
+		case LED_CURVE_EASE_OUT:
+		{
+			uint32_t q = 65535 - p;
+			return 65535 - ((q * q + q) >> 16);
+		}
+		case LED_CURVE_EASE_IN_OUT:
+		{
+			//smoothstep, 3p^2 - 2p^3; the two truncated terms can dip a count or two
+			uint32_t p3 = (p2 * p) >> 16;
+			uint32_t v = 3 * p2 - 2 * p3;
+			return (v > 65535) ? 65535 : v;
+		}
+		case LED_CURVE_EXPONENTIAL:
+		{
+			//(2^(10p) - 1) / 1023, with 2^frac taken as 1 + frac
+			uint32_t x = (uint32_t)p * 10;
+			uint32_t v = (65536UL + (x & 0xFFFF)) << (x >> 16);
+			v = (v - 65536UL) / 1023;
+			return (v > 65535) ? 65535 : v;
+		}
+		default:
+			return p;
+	}
+}
+
+void ledFadeStart(LedFade &fade, uint16_t from, uint16_t to, uint16_t duration, uint8_t curve, uint32_t now)
+{
+	fade.from = from;
+	fade.to = (to > LED_LEVEL_MAX) ? LED_LEVEL_MAX : to;
+	fade.duration = duration;
+	fade.curve = curve;
+	fade.start = now;
+}
+
+bool ledFadeDone(const LedFade &fade, uint32_t now)
+{
+	return (now - fade.start) >= fade.duration;
+}
+
+uint16_t ledFadeLevel(const LedFade &fade, uint32_t now)
+{
+	uint32_t elapsed = now - fade.start;
+	if (elapsed >= fade.duration) {
+		return fade.to;
+	}
+	uint16_t p = (uint16_t)((elapsed << 16) / fade.duration);
+	int32_t delta = (int32_t)fade.to - fade.from;
+	return fade.from + (int16_t)((delta * (int32_t)ledCurve(fade.curve, p)) >> 16);
+}
+
+//maps a level onto cie.value[] as 8.8 fixed point, exact for 101 steps
+#define LED_CIE_POS_SHIFT				10
+#define LED_CIE_POS_SCALE				((((uint32_t)LED_CIE_STEPS - 1) << (8 + LED_CIE_POS_SHIFT)) / LED_LEVEL_MAX)
+
+//interpolates cie.value[] at a level and returns a 16 bit PWM duty
+uint16_t ledCieDuty16(uint16_t level)
+{
+	if (level >= LED_LEVEL_MAX) {
+		return 0xFFFF;
+	}
+	uint32_t pos = ((uint32_t)level * LED_CIE_POS_SCALE) >> LED_CIE_POS_SHIFT;
+	uint16_t index = pos >> 8;
+	uint16_t a = pgm_read_word(&(cie.value[index]));
+	uint16_t b = pgm_read_word(&(cie.value[index + 1]));
+	uint32_t q = ((uint32_t)a << 8) + (uint32_t)(b - a) * (pos & 0xFF);
+	//q is LED_CIE_BITS.8 fixed point, the two shifts scale its full range to 65535
+	return (q >> (LED_CIE_BITS - 8)) + (q >> (2 * LED_CIE_BITS - 8));
+}
+
+#endif
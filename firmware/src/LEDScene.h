@@ -0,0 +1,116 @@
+#ifndef _LED_SCENE_H_
+#define _LED_SCENE_H_
+
+#include <stdint.h>
+#include "EEPROMex.h"
+#include "LEDFade.h"
+
+//LED scenes: a list of (target, curve, duration, hold) steps kept in a
+//reserved EEPROM region and played back through the fade engine without
+//any help from the hub. Steps are read from EEPROM as they are needed so a
+//scene costs no RAM beyond the player state.
+
+#define LED_SCENE_ADDR					896		// reserved EEPROM region, 128 bytes
+#define LED_SCENE_MAX_STEPS			16
+#define LED_SCENE_MAGIC					0x5C
+
+#define LED_SCENE_TRIGGER_NONE	0		// started by kSLedScenePlay only
+#define LED_SCENE_TRIGGER_BOOT	1		// started once after power up
+#define LED_SCENE_TRIGGER_PS		2		// started when the PS turn on level is crossed
+
+struct LedSceneHeader
+{
+	uint8_t magic;
+	uint8_t count;				//number of steps
+	uint8_t loops;				//times to play the steps, 0 repeats forever
+	uint8_t trigger;
+};
+
+//binary layout as uploaded by the hub, little endian
+struct LedSceneStep
+{
+	uint8_t target;				//percent
+	uint8_t curve;				//LED_CURVE_*
+	uint16_t duration;		//fade time, ms
+	uint16_t hold;				//time to stay at target, ms
+};
+
+struct LedScenePlayer
+{
+	LedSceneHeader header;
+	uint8_t step;
+	uint8_t loop;
+	bool playing;
+	bool holding;
+	uint16_t hold;
+	uint32_t holdStart;
+};
+
+int ledSceneStepAddr(uint8_t step)
+{
+	return LED_SCENE_ADDR + sizeof(LedSceneHeader) + step * sizeof(LedSceneStep);
+}
+
+bool ledSceneValid(const LedSceneHeader &header)
+{
+	return header.magic == LED_SCENE_MAGIC && header.count > 0 && header.count <= LED_SCENE_MAX_STEPS;
+}
+
+bool ledSceneLoad(LedScenePlayer &player)
+{
+	EEPROM.readBlock<LedSceneHeader>(LED_SCENE_ADDR, player.header);
+	return ledSceneValid(player.header);
+}
+
+void ledSceneBeginStep(LedScenePlayer &player, LedFade &fade, uint16_t level, uint32_t now)
+{
+	LedSceneStep step;
+	EEPROM.readBlock<LedSceneStep>(ledSceneStepAddr(player.step), step);
+	ledFadeStart(fade, level, LED_LEVEL(step.target), step.duration, step.curve, now);
+	player.hold = step.hold;
+	player.holding = false;
+}
+
+bool ledSceneStart(LedScenePlayer &player, LedFade &fade, uint16_t level, uint32_t now)
+{
+	if (!ledSceneValid(player.header)) {
+		return false;
+	}
+	player.step = 0;
+	player.loop = 0;
+	player.playing = true;
+	ledSceneBeginStep(player, fade, level, now);
+	return true;
+}
+
+//moves to the next step once the current fade and hold have finished
+void ledSceneUpdate(LedScenePlayer &player, LedFade &fade, uint16_t level, uint32_t now)
+{
+	if (!player.playing) {
+		return;
+	}
+	if (!player.holding)
+	{
+		if (ledFadeDone(fade, now)) {
+			player.holding = true;
+			player.holdStart = now;
+		}
+		return;
+	}
+	if ((now - player.holdStart) < player.hold) {
+		return;
+	}
+	player.step++;
+	if (player.step >= player.header.count)
+	{
+		player.step = 0;
+		player.loop++;
+		if (player.header.loops != 0 && player.loop >= player.header.loops) {
+			player.playing = false;
+			return;
+		}
+	}
+	ledSceneBeginStep(player, fade, level, now);
+}
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef _LED_WAVE_H_
+#define _LED_WAVE_H_
+
+#include <stdint.h>
+#include <avr/pgmspace.h>
+#include "LEDFade.h"
+
+//Waveform playback for the breathe and pattern modes. ledWaveLevel() is
+//called from the system tick interrupt, steps a phase accumulator through
+//a PROGMEM shape table and returns the level to output, so the effect does
+//not depend on how often loop() runs.
+
+#define LED_WAVE_BREATHE				0
+#define LED_WAVE_HEARTBEAT			1
+#define LED_WAVE_COUNT					2
+
+#define LED_WAVE_TABLE_BITS			6		// 64 entries per period
+
+//raised cosine, 0..255
+const uint8_t ledWaveBreathe[1 << LED_WAVE_TABLE_BITS] PROGMEM = {
+	0, 1, 2, 5, 10, 15, 21, 29, 37, 47, 57, 67, 79, 90, 103, 115,
+	127, 140, 152, 165, 176, 188, 198, 208, 218, 226, 234, 240, 245, 250, 253, 254,
+	255, 254, 253, 250, 245, 240, 234, 226, 218, 208, 198, 188, 176, 165, 152, 140,
+	128, 115, 103, 90, 79, 67, 57, 47, 37, 29, 21, 15, 10, 5, 2, 1
+};
+
+//double pulse followed by a rest, 0..255
+const uint8_t ledWaveHeartbeat[1 << LED_WAVE_TABLE_BITS] PROGMEM = {
+	0, 19, 58, 128, 211, 254, 227, 149, 72, 26, 7, 3, 5, 14, 34, 67,
+	107, 141, 153, 137, 100, 61, 30, 12, 4, 1, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+};
+
+struct LedWave
+{
+	const uint8_t *table;
+	uint32_t phase;
+	uint32_t step;				//phase increment per tick
+	uint16_t low;					//level at table value 0
+	uint16_t span;				//level added at table value 255
+	uint16_t level;				//last level returned
+	volatile bool active;
+};
+
+//period in ms, tick in us; 4294967 is 2^32 / 1000
+uint32_t ledWaveStep(uint16_t period, uint16_t tick)
+{
+	if (period == 0) {
+		period = 1;
+	}
+	return (4294967UL / period) * tick;
+}
+
+//sets shape, period and amplitude; amplitude is a percentage of low..high
+void ledWaveSet(LedWave &wave, uint8_t shape, uint16_t period, uint16_t tick, uint8_t amplitude, uint16_t low, uint16_t high)
+{
+	if (amplitude > 100) {
+		amplitude = 100;
+	}
+	wave.table = (shape == LED_WAVE_HEARTBEAT) ? ledWaveHeartbeat : ledWaveBreathe;
+	wave.step = ledWaveStep(period, tick);
+	wave.low = low;
+	wave.span = (high > low) ? (uint16_t)(((uint32_t)(high - low) * amplitude) / 100) : 0;
+}
+
+//advances one tick and returns the new level
+uint16_t ledWaveLevel(LedWave &wave)
+{
+	wave.phase += wave.step;
+	uint8_t index = wave.phase >> (32 - LED_WAVE_TABLE_BITS);
+	uint8_t frac = wave.phase >> (24 - LED_WAVE_TABLE_BITS);
+	uint8_t a = pgm_read_byte(&(wave.table[index]));
+	uint8_t b = pgm_read_byte(&(wave.table[(index + 1) & ((1 << LED_WAVE_TABLE_BITS) - 1)]));
+	uint16_t shape = ((uint16_t)a << 8) + (int16_t)(b - a) * frac;
+	wave.level = wave.low + (uint16_t)(((uint32_t)wave.span * shape) >> 16);
+	return wave.level;
+}
+
+#endif
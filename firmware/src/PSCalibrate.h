@@ -0,0 +1,100 @@
+#ifndef _PS_CALIBRATE_H_
+#define _PS_CALIBRATE_H_
+
+#include <stdint.h>
+
+//Proximity cancellation calibration as a time sliced state machine. After
+//the cancellation is cleared it waits PS_CAL_SETTLE_MS, then takes
+//PS_CAL_SAMPLES readings PS_CAL_INTERVAL_MS apart. The run is rejected if
+//the readings vary too much, e.g. because something moved in front of the
+//sensor. Nothing here blocks; the caller feeds it the time and readings.
+
+#define PS_CAL_IDLE							0
+#define PS_CAL_SETTLE						1
+#define PS_CAL_SAMPLE						2
+#define PS_CAL_DONE							3
+#define PS_CAL_FAIL							4
+
+#define PS_CAL_SETTLE_MS				500
+#define PS_CAL_INTERVAL_MS			50
+#define PS_CAL_SAMPLES					16
+#define PS_CAL_MAX_VARIANCE			25		// counts squared
+#define PS_CAL_MAX_DEVIATION		0x0FFF	// keeps the sums in 32 bits, anything wider fails anyway
+
+struct PsCalibration
+{
+	uint8_t state;
+	uint8_t count;				//readings taken
+	uint16_t first;				//readings are summed relative to this
+	int32_t sum;
+	uint32_t sumSq;
+	uint32_t last;				//ms, time of the last step
+	uint16_t result;			//mean reading, the cancellation level
+	uint16_t variance;
+};
+
+bool psCalBusy(const PsCalibration &cal)
+{
+	return cal.state == PS_CAL_SETTLE || cal.state == PS_CAL_SAMPLE;
+}
+
+void psCalStart(PsCalibration &cal, uint32_t now)
+{
+	cal.state = PS_CAL_SETTLE;
+	cal.count = 0;
+	cal.sum = 0;
+	cal.sumSq = 0;
+	cal.last = now;
+	cal.result = 0;
+	cal.variance = 0;
+}
+
+//true when the next reading should be taken
+bool psCalDue(PsCalibration &cal, uint32_t now)
+{
+	switch (cal.state)
+	{
+		case PS_CAL_SETTLE:
+			if ((now - cal.last) < PS_CAL_SETTLE_MS) {
+				return false;
+			}
+			cal.state = PS_CAL_SAMPLE;
+			return true;
+		case PS_CAL_SAMPLE:
+			return (now - cal.last) >= PS_CAL_INTERVAL_MS;
+		default:
+			return false;
+	}
+}
+
+//adds a reading and returns the new state
+uint8_t psCalAdd(PsCalibration &cal, uint16_t reading, uint32_t now)
+{
+	cal.last = now;
+	if (cal.count == 0) {
+		cal.first = reading;
+	}
+	int32_t d = (int32_t)reading - cal.first;
+	if (d > PS_CAL_MAX_DEVIATION || d < -PS_CAL_MAX_DEVIATION)
+	{
+		cal.variance = 0xFFFF;
+		cal.state = PS_CAL_FAIL;
+		return cal.state;
+	}
+	cal.sum += d;
+	cal.sumSq += (uint32_t)(d * d);
+	cal.count++;
+	if (cal.count < PS_CAL_SAMPLES) {
+		return cal.state;
+	}
+
+	uint32_t sumAbs = (cal.sum < 0) ? -cal.sum : cal.sum;
+	uint32_t variance = (cal.sumSq - (sumAbs * sumAbs) / PS_CAL_SAMPLES) / PS_CAL_SAMPLES;
+	cal.variance = (variance > 0xFFFF) ? 0xFFFF : variance;
+	int32_t mean = cal.first + (cal.sum + (cal.sum >= 0 ? PS_CAL_SAMPLES / 2 : -(PS_CAL_SAMPLES / 2))) / PS_CAL_SAMPLES;
+	cal.result = (mean < 0) ? 0 : mean;
+	cal.state = (cal.variance <= PS_CAL_MAX_VARIANCE) ? PS_CAL_DONE : PS_CAL_FAIL;
+	return cal.state;
+}
+
+#endif
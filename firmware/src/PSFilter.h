@@ -0,0 +1,80 @@
+#ifndef _PS_FILTER_H_
+#define _PS_FILTER_H_
+
+#include <stdint.h>
+
+//Proximity filter stage between the sensor read and the night light logic.
+//A median of the last 1, 3 or 5 readings knocks out single noisy samples,
+//then an exponential moving average with alpha = 1 / 2^shift smooths what
+//is left. Integer only, fixed RAM and a bounded cost per sample.
+
+#define PS_FILTER_MEDIAN_MAX		5
+#define PS_FILTER_SHIFT_MAX			6		// alpha down to 1/64
+#define PS_FILTER_EMA_FRAC			8		// fractional bits kept in the average
+
+struct PsFilter
+{
+	uint16_t window[PS_FILTER_MEDIAN_MAX];
+	uint8_t median;				//window length, odd, 1 for none
+	uint8_t index;				//next window slot
+	uint8_t fill;					//readings in the window so far
+	uint8_t shift;				//0 for no averaging
+	uint32_t ema;					//average with PS_FILTER_EMA_FRAC fractional bits
+};
+
+bool psFilterValid(uint8_t median, uint8_t shift)
+{
+	return (median & 1) && median <= PS_FILTER_MEDIAN_MAX && shift <= PS_FILTER_SHIFT_MAX;
+}
+
+void psFilterInit(PsFilter &filter, uint8_t median, uint8_t shift)
+{
+	filter.median = median;
+	filter.shift = shift;
+	filter.index = 0;
+	filter.fill = 0;
+	filter.ema = 0;
+}
+
+//median of the readings held so far, by insertion sort of a copy
+uint16_t psFilterMedian(const PsFilter &filter)
+{
+	uint16_t sorted[PS_FILTER_MEDIAN_MAX];
+	for (uint8_t i = 0; i < filter.fill; i++)
+	{
+		uint16_t v = filter.window[i];
+		uint8_t j = i;
+		while (j > 0 && sorted[j - 1] > v)
+		{
+			sorted[j] = sorted[j - 1];
+			j--;
+		}
+		sorted[j] = v;
+	}
+	return sorted[filter.fill / 2];
+}
+
+//takes a raw reading and returns the filtered value
+uint16_t psFilterUpdate(PsFilter &filter, uint16_t sample)
+{
+	filter.window[filter.index] = sample;
+	filter.index = (filter.index + 1 < filter.median) ? filter.index + 1 : 0;
+	bool first = (filter.fill == 0);
+	if (filter.fill < filter.median) {
+		filter.fill++;
+	}
+	uint32_t value = (uint32_t)psFilterMedian(filter) << PS_FILTER_EMA_FRAC;
+	//start the average at the first reading rather than creeping up from 0
+	if (first || filter.shift == 0) {
+		filter.ema = value;
+	}
+	else if (value >= filter.ema) {
+		filter.ema += (value - filter.ema) >> filter.shift;
+	}
+	else {
+		filter.ema -= (filter.ema - value) >> filter.shift;
+	}
+	return (filter.ema + (1 << (PS_FILTER_EMA_FRAC - 1))) >> PS_FILTER_EMA_FRAC;
+}
+
+#endif
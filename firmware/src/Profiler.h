@@ -0,0 +1,119 @@
+#ifndef _PROFILER_H_
+#define _PROFILER_H_
+
+#include <Arduino.h>
+#include <stdint.h>
+
+//Loop profiler. Define SYS_PROFILER to build it in; without it every macro
+//below expands to nothing and the profiler costs no flash or RAM.
+
+#define PROFILE_TASK_SERIAL			0
+#define PROFILE_TASK_LED				1
+#define PROFILE_TASK_SENSORS		2
+#define PROFILE_TASK_PUSH				3
+#define PROFILE_TASK_EEPROM			4
+#define PROFILE_TASK_CALIBRATE	5
+#define PROFILE_TASK_COUNT			6
+
+//loop period histogram, bucket n counts periods below 32us << n,
+//the last bucket collects everything longer
+#define PROFILE_HIST_BUCKETS		12
+#define PROFILE_HIST_MIN_SHIFT	5
+
+#ifdef SYS_PROFILER
+
+struct ProfileTask
+{
+	uint32_t min;
+	uint32_t max;
+	uint32_t sum;
+	uint16_t count;
+};
+
+ProfileTask profileTasks[PROFILE_TASK_COUNT];
+uint16_t profileLoopHist[PROFILE_HIST_BUCKETS];
+uint32_t profileLoopLast;
+volatile uint16_t profileIsrMax;
+
+void profileReset(void)
+{
+	for (uint8_t i = 0; i < PROFILE_TASK_COUNT; i++)
+	{
+		profileTasks[i].min = 0xFFFFFFFF;
+		profileTasks[i].max = 0;
+		profileTasks[i].sum = 0;
+		profileTasks[i].count = 0;
+	}
+	for (uint8_t i = 0; i < PROFILE_HIST_BUCKETS; i++)
+	{
+		profileLoopHist[i] = 0;
+	}
+	profileLoopLast = 0;
+	profileIsrMax = 0;
+}
+
+void profileRecord(uint8_t task, uint32_t duration)
+{
+	ProfileTask &t = profileTasks[task];
+	if (duration < t.min) {
+		t.min = duration;
+	}
+	if (duration > t.max) {
+		t.max = duration;
+	}
+	//halve the running totals instead of overflowing so the mean keeps
+	//tracking recent behaviour
+	if (t.count == 0xFFFF || t.sum > 0x7FFFFFFF - duration) {
+		t.sum >>= 1;
+		t.count >>= 1;
+	}
+	t.sum += duration;
+	t.count++;
+}
+
+uint32_t profileMean(uint8_t task)
+{
+	if (profileTasks[task].count == 0) {
+		return 0;
+	}
+	return profileTasks[task].sum / profileTasks[task].count;
+}
+
+void profileLoop(void)
+{
+	uint32_t now = micros();
+	if (profileLoopLast != 0)
+	{
+		uint32_t period = (now - profileLoopLast) >> PROFILE_HIST_MIN_SHIFT;
+		uint8_t bucket = 0;
+		while (period && bucket < PROFILE_HIST_BUCKETS - 1)
+		{
+			period >>= 1;
+			bucket++;
+		}
+		if (profileLoopHist[bucket] < 0xFFFF) {
+			profileLoopHist[bucket]++;
+		}
+	}
+	profileLoopLast = now;
+}
+
+#define PROFILE_INIT()							profileReset()
+#define PROFILE_LOOP()							profileLoop()
+#define PROFILE_BEGIN(name)					uint32_t profileStart_##name = micros()
+#define PROFILE_END(name, task)			profileRecord(task, micros() - profileStart_##name)
+#define PROFILE_ISR_BEGIN()					uint16_t profileIsrStart = (uint16_t)micros()
+#define PROFILE_ISR_END()						do { uint16_t d = (uint16_t)micros() - profileIsrStart; if (d > profileIsrMax) profileIsrMax = d; } while (0)
+
+#else
+
+#define PROFILE_INIT()
+#define PROFILE_LOOP()
+#define PROFILE_BEGIN(name)
+#define PROFILE_END(name, task)
+#define PROFILE_ISR_BEGIN()
+#define PROFILE_ISR_END()
+
+#endif
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef _RAM_MONITOR_H_
+#define _RAM_MONITOR_H_
+
+#include <Arduino.h>
+#include <stdint.h>
+
+//SRAM use at run time. Before the C runtime sets anything up, ramPaint()
+//fills everything between the end of .bss and the top of RAM with a canary.
+//The stack overwrites it as it grows down, so the canary left untouched
+//above the heap is the least free RAM there has been since reset.
+//
+//The native build has no AVR memory map, so there the figures read 0.
+
+#define RAM_CANARY		0xC5
+
+//the core's Serial buffers; the native stand-in has its own, bigger ones
+#ifdef SERIAL_RX_BUFFER_SIZE
+#define RAM_SERIAL_RX_BUFFER	SERIAL_RX_BUFFER_SIZE
+#define RAM_SERIAL_TX_BUFFER	SERIAL_TX_BUFFER_SIZE
+#else
+#define RAM_SERIAL_RX_BUFFER	0
+#define RAM_SERIAL_TX_BUFFER	0
+#endif
+
+//__AVR_ARCH__ comes from avr-gcc itself; the native stand-ins define __AVR__
+#ifdef __AVR_ARCH__
+
+extern uint8_t _end;
+extern uint8_t __stack;
+extern uint8_t __heap_start;
+extern char *__brkval;
+
+//runs from .init1, with no stack and r1 not yet cleared, so it is written
+//without either
+void ramPaint(void) __attribute__((naked, used, section(".init1")));
+void ramPaint(void)
+{
+	__asm volatile (
+		"	ldi r30, lo8(_end)\n"
+		"	ldi r31, hi8(_end)\n"
+		"	ldi r24, %0\n"
+		"	ldi r25, hi8(__stack)\n"
+		"	rjmp 2f\n"
+		"1:	st Z+, r24\n"
+		"2:	cpi r30, lo8(__stack)\n"
+		"	cpc r31, r25\n"
+		"	brlo 1b\n"
+		"	breq 1b\n"
+		:: "i" (RAM_CANARY));
+}
+
+static inline uint8_t *ramHeapEnd(void)
+{
+	return (__brkval != 0) ? (uint8_t *)__brkval : &__heap_start;
+}
+
+//bytes between the heap and the stack right now
+uint16_t ramFree(void)
+{
+	return (uint16_t)SP - (uint16_t)ramHeapEnd();
+}
+
+//the least free RAM since reset
+uint16_t ramLowWater(void)
+{
+	const uint8_t *p = ramHeapEnd();
+	uint16_t count = 0;
+	while (p <= &__stack && *p == RAM_CANARY)
+	{
+		p++;
+		count++;
+	}
+	return count;
+}
+
+//.data and .bss together
+uint16_t ramStatic(void)
+{
+	return (uint16_t)&__heap_start - RAMSTART;
+}
+
+#else
+
+uint16_t ramFree(void) { return 0; }
+uint16_t ramLowWater(void) { return 0; }
+uint16_t ramStatic(void) { return 0; }
+
+#endif
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef _SAMPLE_DUMP_H_
+#define _SAMPLE_DUMP_H_
+
+#include <stdint.h>
+#include <util/crc16.h>
+#include "Samples.h"
+
+//Compressed history export. The ring is sent as self describing blocks of
+//up to SAMPLE_DUMP_BLOCK_SAMPLES samples:
+//
+//  format, channel count, sample count, first sequence number (uint32 LE),
+//  for each sample the time and every channel as a zig-zag varint of the
+//  difference from the previous sample (from 0 for the first one),
+//  CRC-16 (LE) of everything before it, as _crc16_update from 0xFFFF.
+//
+//Differences wrap at 16 bits. host/ holds the matching decoder.
+
+#define SAMPLE_DUMP_FORMAT				1
+#define SAMPLE_DUMP_BLOCK_SAMPLES	8
+#define SAMPLE_DUMP_HEADER				7
+#define SAMPLE_DUMP_BLOCK_MAX			(SAMPLE_DUMP_HEADER + SAMPLE_DUMP_BLOCK_SAMPLES * (SAMPLE_CHANNELS + 1) * 3 + 2)
+
+//writes value as a varint, 7 bits a byte with the high bit set on all but
+//the last; returns the bytes used
+uint8_t sampleDumpVarint(uint8_t *out, uint16_t value)
+{
+	uint8_t n = 0;
+	while (value >= 0x80)
+	{
+		out[n++] = (value & 0x7F) | 0x80;
+		value >>= 7;
+	}
+	out[n++] = value;
+	return n;
+}
+
+//maps small differences of either sign onto small codes, 0, -1, 1, -2 ...
+uint16_t sampleDumpZigZag(uint16_t from, uint16_t to)
+{
+	int16_t delta = (int16_t)(to - from);
+	return ((uint16_t)delta << 1) ^ (uint16_t)(delta >> 15);
+}
+
+uint32_t sampleDumpOldest(const SampleRing &ring)
+{
+	return ring.total - ring.count;
+}
+
+//encodes the samples from seq on into block, which must hold
+//SAMPLE_DUMP_BLOCK_MAX bytes. A seq that has already left the ring starts
+//at the oldest sample instead, the header says where the block starts.
+//Returns the block length, 0 when there is nothing from seq on
+uint8_t sampleDumpBlock(const SampleRing &ring, uint32_t seq, uint8_t *block)
+{
+	if ((int32_t)(seq - sampleDumpOldest(ring)) < 0) {
+		seq = sampleDumpOldest(ring);
+	}
+	if ((int32_t)(ring.total - seq) <= 0) {
+		return 0;
+	}
+	uint8_t count = (ring.total - seq > SAMPLE_DUMP_BLOCK_SAMPLES) ? SAMPLE_DUMP_BLOCK_SAMPLES : ring.total - seq;
+	uint8_t len = 0;
+	block[len++] = SAMPLE_DUMP_FORMAT;
+	block[len++] = SAMPLE_CHANNELS;
+	block[len++] = count;
+	for (uint8_t i = 0; i < 4; i++) {
+		block[len++] = seq >> (8 * i);
+	}
+
+	const Sample *prev = 0;
+	for (uint8_t i = 0; i < count; i++)
+	{
+		const Sample &sample = sampleAt(ring, ring.total - 1 - (seq + i));
+		len += sampleDumpVarint(block + len, sampleDumpZigZag(prev ? prev->time : 0, sample.time));
+		for (uint8_t c = 0; c < SAMPLE_CHANNELS; c++) {
+			len += sampleDumpVarint(block + len, sampleDumpZigZag(prev ? prev->value[c] : 0, sample.value[c]));
+		}
+		prev = &sample;
+	}
+
+	uint16_t crc = 0xFFFF;
+	for (uint8_t i = 0; i < len; i++) {
+		crc = _crc16_update(crc, block[i]);
+	}
+	block[len++] = crc;
+	block[len++] = crc >> 8;
+	return len;
+}
+
+#endif
@@ -0,0 +1,117 @@
+#ifndef _SAMPLES_H_
+#define _SAMPLES_H_
+
+#include <stdint.h>
+
+//Sample history. A fixed ring of compact timestamped readings, one every
+//SAMPLE_PERIOD_MS, so the hub can ask for aggregates over a window instead
+//of collecting every push. No heap; the ring is a plain array and indexes
+//wrap with a mask.
+
+#ifndef SAMPLE_RING_SIZE
+#define SAMPLE_RING_SIZE				32		// power of two
+#endif
+#define SAMPLE_RING_MASK				(SAMPLE_RING_SIZE - 1)
+
+#define SAMPLE_CH_TEMPERATURE		0
+#define SAMPLE_CH_HUMIDITY			1
+#define SAMPLE_CH_PRESSURE			2		// Pa above SAMPLE_PRESSURE_OFFSET
+#define SAMPLE_CH_LUX						3
+#define SAMPLE_CH_PS						4
+#define SAMPLE_CHANNELS					5
+
+#define SAMPLE_PRESSURE_OFFSET	50000UL
+
+static_assert((SAMPLE_RING_SIZE & SAMPLE_RING_MASK) == 0 && SAMPLE_RING_SIZE <= 128,
+	"SAMPLE_RING_SIZE must be a power of two no larger than 128");
+
+struct Sample
+{
+	uint16_t time;				//seconds, wraps every 18 hours
+	uint16_t value[SAMPLE_CHANNELS];
+};
+
+struct SampleRing
+{
+	Sample samples[SAMPLE_RING_SIZE];
+	uint8_t head;					//next slot to write
+	uint8_t count;
+	uint32_t total;				//samples taken since boot, the next sequence number
+};
+
+struct SampleStats
+{
+	uint8_t count;				//samples inside the window
+	uint16_t min;
+	uint16_t max;
+	uint16_t mean;
+};
+
+uint16_t samplePressure(uint32_t pressure)
+{
+	if (pressure <= SAMPLE_PRESSURE_OFFSET) {
+		return 0;
+	}
+	pressure -= SAMPLE_PRESSURE_OFFSET;
+	return (pressure > 0xFFFF) ? 0xFFFF : pressure;
+}
+
+void samplePush(SampleRing &ring, uint16_t time, const uint16_t *values)
+{
+	Sample &sample = ring.samples[ring.head];
+	sample.time = time;
+	for (uint8_t i = 0; i < SAMPLE_CHANNELS; i++) {
+		sample.value[i] = values[i];
+	}
+	ring.head = (ring.head + 1) & SAMPLE_RING_MASK;
+	if (ring.count < SAMPLE_RING_SIZE) {
+		ring.count++;
+	}
+	ring.total++;
+}
+
+//age 0 is the newest sample
+const Sample &sampleAt(const SampleRing &ring, uint8_t age)
+{
+	return ring.samples[(ring.head - 1 - age) & SAMPLE_RING_MASK];
+}
+
+//number of samples taken within window seconds of now, newest first;
+//a window of 0 covers the whole ring
+uint8_t sampleWindow(const SampleRing &ring, uint16_t now, uint16_t window)
+{
+	uint8_t n = 0;
+	while (n < ring.count && (window == 0 || (uint16_t)(now - sampleAt(ring, n).time) <= window)) {
+		n++;
+	}
+	return n;
+}
+
+//min, max and mean of one channel over the newest n samples
+void sampleStats(const SampleRing &ring, uint8_t channel, uint8_t n, SampleStats &stats)
+{
+	uint32_t sum = 0;
+	stats.count = n;
+	stats.min = 0xFFFF;
+	stats.max = 0;
+	for (uint8_t i = 0; i < n; i++)
+	{
+		uint16_t v = sampleAt(ring, i).value[channel];
+		if (v < stats.min) {
+			stats.min = v;
+		}
+		if (v > stats.max) {
+			stats.max = v;
+		}
+		sum += v;
+	}
+	if (n == 0) {
+		stats.min = 0;
+		stats.mean = 0;
+	}
+	else {
+		stats.mean = (sum + n / 2) / n;
+	}
+}
+
+#endif
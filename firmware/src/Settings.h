@@ -0,0 +1,93 @@
+#ifndef _SETTINGS_H_
+#define _SETTINGS_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <util/crc16.h>
+#include "EEPROMVar.h"
+
+//Persistent settings, stored as CRC protected records in a wear levelled
+//EEPROM journal. Bump SETTINGS_VERSION whenever the layout changes and add
+//a migration. Settings the hub changes often are SettingsVars, which are
+//kept in the record but committed like EEPROMVars, once they have been
+//left alone for a while.
+
+#define SETTINGS_JOURNAL_ADDR			128		// up to the LED scene region
+#define SETTINGS_JOURNAL_SIZE			768
+#define SETTINGS_VERSION					1
+#define SETTINGS_PUSH_CHANNELS		6			// PUSH_CHANNELS in main.cpp
+
+//layout used before the settings record, kept for migration
+#define SETTINGS_LEGACY_FLAG_ADDR	0
+#define SETTINGS_LEGACY_FLAG			1
+
+struct Settings
+{
+	uint8_t version;
+	uint8_t dataPushMode;
+	uint32_t dataPushInterval;
+	uint8_t ledControlMode;
+	uint8_t ledFadeTargetMin;
+	uint8_t ledFadeTargetMax;
+	uint8_t psCalibrated;
+	uint16_t psCal;
+	uint16_t pushDeadband[SETTINGS_PUSH_CHANNELS];
+	uint16_t pushHeartbeat;
+	uint8_t psFilterMedianN;
+	uint8_t psFilterShift;
+	uint8_t alsRangeMode;
+	uint16_t crc;							//CRC-16 of everything above
+} __attribute__((packed));
+
+//a record only goes through the write queue if its journal slot, with the
+//sequence number and CRC, fits in the queue
+static_assert(sizeof(Settings) + sizeof(uint32_t) + sizeof(uint16_t) < EEPROM_QUEUE_SIZE, "raise EEPROM_QUEUE_SIZE in EEPROMex.h");
+
+uint16_t settingsCrc(const Settings &settings)
+{
+	const uint8_t *data = (const uint8_t *)&settings;
+	uint16_t crc = 0xFFFF;
+	for (uint8_t i = 0; i < offsetof(Settings, crc); i++)
+	{
+		crc = _crc16_update(crc, data[i]);
+	}
+	return crc;
+}
+
+//set when a SettingsVar has been committed and the record needs writing
+bool settingsDirty = false;
+
+//An EEPROMVar with no cell of its own. Changes are tracked and committed
+//with the other EEPROMVars; the commit only sets settingsDirty, and the
+//value goes to EEPROM with the next settings record.
+template<typename T> class SettingsVar : public EEPROMVar<T>
+{
+	public:
+	  SettingsVar(const T& init):
+		EEPROMVar<T>(init, -1)
+	  {
+	  }
+	  using EEPROMVar<T>::operator=;
+
+	  // takes a value from the record without marking it for a write
+	  void load(const T& val) {
+		this->var = val;
+		this->dirty = false;
+	  }
+	protected:
+	  void commit() {
+		settingsDirty = true;
+		this->dirty = false;
+	  }
+	private:
+	  using EEPROMVar<T>::save;
+	  using EEPROMVar<T>::update;
+	  using EEPROMVar<T>::restore;
+};
+
+bool settingsValid(const Settings &settings)
+{
+	return settings.version == SETTINGS_VERSION && settings.crc == settingsCrc(settings);
+}
+
+#endif
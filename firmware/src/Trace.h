@@ -0,0 +1,211 @@
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+#include <Arduino.h>
+#include <stdint.h>
+
+//Serial trace. Define SYS_TRACE to build it in: CmdMessenger then talks
+//through traceStream, which passes everything on to Serial and keeps the
+//frames going each way, up to and including the command separator, in a
+//RAM ring with the millis() they started at. kQTrace sends the ring back
+//oldest first and empties it. Without SYS_TRACE CmdMessenger uses Serial
+//directly and the trace costs no flash or RAM.
+//
+//A ring entry is a header byte, the time (uint32 LE) and the frame:
+//
+//  bit 7 out (sent by the node), bit 6 truncated, bits 0..5 length
+//
+//Frames longer than TRACE_FRAME_MAX keep their first TRACE_FRAME_MAX
+//bytes. When the ring is full the oldest frames go to make room.
+
+#define TRACE_RING_SIZE				256
+#define TRACE_FRAME_MAX				48			// at most 63, the header holds the length
+#define TRACE_ENTRY_HEADER		5
+
+#define TRACE_IN							0
+#define TRACE_OUT							1
+
+#define TRACE_FLAG_OUT				0x80
+#define TRACE_FLAG_TRUNCATED	0x40
+#define TRACE_LENGTH_MASK			0x3F
+
+#ifdef SYS_TRACE
+
+//a frame being received or sent, copied into the ring once it ends
+struct TraceFrame
+{
+	uint32_t time;
+	uint8_t length;
+	bool truncated;
+	bool escaped;									// the last byte was the escape character
+	uint8_t data[TRACE_FRAME_MAX];
+};
+
+struct TraceRing
+{
+	uint8_t data[TRACE_RING_SIZE];
+	uint16_t head;								// where the next entry goes
+	uint16_t tail;								// the oldest entry
+	uint16_t used;
+	uint16_t frames;
+	uint16_t dropped;							// frames pushed out since the last dump
+	uint16_t marked;							// frames still to send in the dump under way
+};
+
+TraceRing traceRing;
+
+void traceRingPut(TraceRing &ring, uint8_t b)
+{
+	ring.data[ring.head] = b;
+	ring.head = (ring.head + 1) % TRACE_RING_SIZE;
+}
+
+uint8_t traceRingAt(const TraceRing &ring, uint16_t offset)
+{
+	return ring.data[(ring.tail + offset) % TRACE_RING_SIZE];
+}
+
+uint16_t traceEntrySize(const TraceRing &ring)
+{
+	return TRACE_ENTRY_HEADER + (traceRingAt(ring, 0) & TRACE_LENGTH_MASK);
+}
+
+void traceRingDrop(TraceRing &ring)
+{
+	uint16_t size = traceEntrySize(ring);
+	ring.tail = (ring.tail + size) % TRACE_RING_SIZE;
+	ring.used -= size;
+	ring.frames--;
+}
+
+void traceRingAdd(TraceRing &ring, uint8_t direction, const TraceFrame &frame)
+{
+	uint16_t size = TRACE_ENTRY_HEADER + frame.length;
+	while (ring.used + size > TRACE_RING_SIZE)
+	{
+		traceRingDrop(ring);
+		ring.dropped++;
+		//the oldest frame was one the dump had still to send
+		if (ring.marked) {
+			ring.marked--;
+		}
+	}
+	uint8_t header = frame.length;
+	if (direction == TRACE_OUT) {
+		header |= TRACE_FLAG_OUT;
+	}
+	if (frame.truncated) {
+		header |= TRACE_FLAG_TRUNCATED;
+	}
+	traceRingPut(ring, header);
+	for (uint8_t i = 0; i < 4; i++) {
+		traceRingPut(ring, (uint8_t)(frame.time >> (8 * i)));
+	}
+	for (uint8_t i = 0; i < frame.length; i++) {
+		traceRingPut(ring, frame.data[i]);
+	}
+	ring.used += size;
+	ring.frames++;
+}
+
+//copies the oldest entry out and drops it; false when the ring is empty
+bool traceRingTake(TraceRing &ring, uint8_t &header, uint32_t &time, uint8_t *frame)
+{
+	if (ring.frames == 0) {
+		return false;
+	}
+	header = traceRingAt(ring, 0);
+	time = 0;
+	for (uint8_t i = 0; i < 4; i++) {
+		time |= (uint32_t)traceRingAt(ring, 1 + i) << (8 * i);
+	}
+	for (uint8_t i = 0; i < (header & TRACE_LENGTH_MASK); i++) {
+		frame[i] = traceRingAt(ring, TRACE_ENTRY_HEADER + i);
+	}
+	traceRingDrop(ring);
+	return true;
+}
+
+//adds a byte to a frame; true once it is the unescaped command separator.
+//Line ends between frames are left out.
+bool traceFrameByte(TraceFrame &frame, uint8_t b)
+{
+	if (frame.length == 0 && !frame.truncated)
+	{
+		if (b == '\r' || b == '\n') {
+			return false;
+		}
+		frame.time = millis();
+	}
+	if (frame.length < TRACE_FRAME_MAX) {
+		frame.data[frame.length++] = b;
+	}
+	else {
+		frame.truncated = true;
+	}
+	if (frame.escaped) {
+		frame.escaped = false;
+		return false;
+	}
+	if (b == '/') {
+		frame.escaped = true;
+		return false;
+	}
+	return b == ';';
+}
+
+class TraceStream : public Stream
+{
+public:
+	TraceStream(Stream &stream) : _stream(stream), _hold(false), _in(), _out() {}
+	//leaves what is sent out of the trace, for sending the trace itself
+	void hold(bool hold) { _hold = hold; }
+
+	int available() { return _stream.available(); }
+	int peek() { return _stream.peek(); }
+	void flush() { _stream.flush(); }
+	int read()
+	{
+		int c = _stream.read();
+		if (c >= 0) {
+			record(TRACE_IN, _in, (uint8_t)c);
+		}
+		return c;
+	}
+	size_t write(uint8_t c)
+	{
+		if (!_hold) {
+			record(TRACE_OUT, _out, c);
+		}
+		return _stream.write(c);
+	}
+	using Print::write;
+
+private:
+	void record(uint8_t direction, TraceFrame &frame, uint8_t c)
+	{
+		if (traceFrameByte(frame, c))
+		{
+			traceRingAdd(traceRing, direction, frame);
+			frame.length = 0;
+			frame.truncated = false;
+		}
+	}
+
+	Stream &_stream;
+	bool _hold;
+	TraceFrame _in;
+	TraceFrame _out;
+};
+
+TraceStream traceStream(Serial);
+
+#define TRACE_STREAM		traceStream
+
+#else
+
+#define TRACE_STREAM		Serial
+
+#endif
+
+#endif
@@ -3,28 +3,53 @@
 #include <avr/pgmspace.h>
 #include <avr/power.h>
 #include <avr/sleep.h>
+#include <util/atomic.h>
 #include "EEPROMex.h"
+#include "EEPROMVar.h"
 #include "SparkFunBME280.h"
 #include "Wire.h"
 #include "SPI.h"
 #include "VCNL4040.h"
 #include "TimerOne.h"
+#include "TimerTwo.h"
 #include "CmdMessenger.h"
 #include "SoftReset.h"
 #include "LED.h"
+#include "LEDFade.h"
+#include "LEDWave.h"
+#include "LEDScene.h"
+#include "Settings.h"
+#include "Samples.h"
+#include "SampleDump.h"
+#include "PSFilter.h"
+#include "PSCalibrate.h"
+#include "RamMonitor.h"
 
 #define APP_FW_VER "1.0.0-rc.1"
 
+//#define SYS_PROFILER			// Enables the loop profiler and kQProfile
+#include "Profiler.h"
+
+//#define SYS_TRACE				// Keeps the serial frames in a RAM ring for kQTrace
+#include "Trace.h"
+
+#ifdef SYS_BENCH								// Set by env:bench, runs bench/Bench.cpp instead of loop()
+void benchRun(void);
+#endif
+
 #define SYS_STATUS_OK						0x090d
 #define SYS_SETTINGS_SAVED			0x055d
 #define SYS_STATUS_NO_CLIMATE		0x2bad
 #define SYS_STATUS_NO_ALS				0x3bad
 #define SYS_PS_CALIBRATED				0x355c
 #define SYS_PS_CALIBRATE_FAIL		0x35fc
+#define SYS_PS_CALIBRATING			0x355a
 #define SYS_STATUS_NO_SENSORS		0xabad
 
 
 #define LEDPIN 9
+#define LED_PWM_PERIOD		400		// PWM carrier period on Timer1, us
+#define SYS_TICK_PERIOD		400		// sysTaskTimer period on Timer2, us
 
 #define SYS_TASK_DEFAULT				0
 #define SYS_TASK_PUSH_DATA			1
@@ -32,6 +57,12 @@
 #define SYS_TASK_SAVE_SETTINGS	3
 #define SYS_TASK_CALIBRATE			4
 
+#define SYS_PUSH_MODE_OFF				0
+#define SYS_PUSH_MODE_ALL				1		// every channel each sysDataPushInterval
+#define SYS_PUSH_MODE_EXCEPTION	2		// only channels that moved past their deadband
+
+#define SYS_COMMIT_QUIET_MS			2000	// EEPROMVars are written once left alone this long
+
 #define NONE	0
 #define OFF		0
 #define ON		1
@@ -41,8 +72,10 @@ uint32_t sysDataPushInterval;
 uint8_t sysDataPushMode;
 uint16_t sysStatus;
 void sysLoadSettings(void);
+void sysLoadLegacySettings(void);
 void sysSaveSettings(void);
 void sysLoadDefault(void);
+bool sysSettingsSaving = false;			// save queued, SYS_SETTINGS_SAVED sent once written
 uint16_t sysBootTest(void);
 
 //System Tasker
@@ -72,8 +105,57 @@ uint16_t temperature;
 uint16_t humidity;
 uint32_t pressure;
 uint16_t lux;
-uint16_t ps;
+uint32_t luxMilli;							// lux at the resolution of the current ALS range
+uint16_t white;									// WHITE channel counts, read with the ALS
+uint16_t whiteRatio;						// WHITE over ALS counts, 1/1000
+void sensorReadALS(void);
+void sensorSendLux(void);
+#define ALS_RANGE_AUTO				VCNL4040_ALS_RANGES		// above the fixed ranges 0..3
+SettingsVar<uint8_t> alsRangeMode(ALS_RANGE_AUTO);
+void alsApplyRange(void);
+uint16_t ps;										// filtered
 uint16_t psCal;
+PsFilter psFilter;
+uint16_t psGap;									// ms between the readings the filter takes, 0 for every pass
+uint32_t psLast;								// millis() of the last of them
+PsCalibration psCalibration;
+bool psCalibrationRestore;			// calibrated before the run, put psCal back if it fails
+void psCalibrationTask(void);
+SettingsVar<uint8_t> psFilterMedianN(3);
+SettingsVar<uint8_t> psFilterShift(2);
+
+#define SAMPLE_PERIOD_MS		60000		// one history sample a minute, 32 minutes of history
+SampleRing sampleRing;
+uint32_t sampleLast;
+void sampleRecord(void);
+bool sampleDumping = false;
+uint32_t sampleDumpSeq;					// next sequence number to send
+uint8_t sampleDumpBlocks;				// blocks left to send
+void sampleDumpNext(void);
+#ifdef SYS_TRACE
+bool traceDumping = false;
+void traceDumpNext(void);
+#endif
+
+//report by exception, deadbands in each channel's own units; the history
+//channels plus the ones that are only pushed
+#define PUSH_CH_WHITE_RATIO		SAMPLE_CHANNELS
+#define PUSH_CHANNELS					(SAMPLE_CHANNELS + 1)
+static_assert(PUSH_CHANNELS == SETTINGS_PUSH_CHANNELS, "the settings record keeps a deadband per push channel");
+SettingsVar<uint16_t> pushDeadband[PUSH_CHANNELS] = {
+	{1},						// temperature, C
+	{1},						// humidity, %
+	{20},						// pressure, Pa
+	{2},						// lux
+	{2},						// ps
+	{50}						// white ratio, 1/1000
+};
+SettingsVar<uint16_t> pushHeartbeat(300);		// s, 0 for none
+uint32_t pushLastValue[PUSH_CHANNELS];
+uint32_t pushLastSent[PUSH_CHANNELS];
+uint8_t pushSent;							// bit per channel, set once it has been reported
+uint32_t pushSuppressed;
+bool pushDue(uint8_t channel, uint32_t value, uint32_t now);
 
 //night light
 #define LED_CONTROL_MODE_RESTORE	0
@@ -87,20 +169,32 @@ uint16_t psCal;
 bool ledPSTimeoutStart = false;
 bool ledPSTimedout = false;
 uint16_t ledPSTimeout = 30000;
-uint8_t ledFadeTargetMin;
-uint8_t ledFadeTargetMax;
+SettingsVar<uint8_t> ledFadeTargetMin(0);
+SettingsVar<uint8_t> ledFadeTargetMax(100);
 uint8_t ledFade;
-uint8_t ledControlMode;
+uint16_t ledLevel;
+LedFade ledFadeState;
+SettingsVar<uint8_t> ledControlMode(LED_CONTROL_MODE_ALS_PS);
 uint8_t ledControlModeRestore;
 
 void ledController(void);
 void ledPSControl(void);
-void ledFadeTo(uint8_t pin, uint8_t brightness);
+void ledFadeTo(uint8_t pin, uint16_t level);
 bool ledFadeFlag = false;
 uint8_t ledFadeTarget = 0;
+#define LED_FADE_STEP_MS	4		// default fade time per percent of brightness
+
+LedWave ledWave;
+uint8_t ledWaveShape = LED_WAVE_BREATHE;
+uint16_t ledWavePeriod = 4000;
+uint8_t ledWaveAmplitude = 100;
+void ledWaveApply(void);
+
+LedScenePlayer ledScene;
+bool ledScenePsNear;					// PS past the turn on level, cleared below the turn off level
 
 //command messenger
-CmdMessenger cmdMessenger = CmdMessenger(Serial);
+CmdMessenger cmdMessenger = CmdMessenger(TRACE_STREAM);
 void onReturnStatus(void);
 void onReturnDeviceInfo(void);
 void onSaveSettings(void);
@@ -119,9 +213,29 @@ void onLedRestoreMode(void);
 void onLedSetFadeLimits(void);
 void onLedReturnFadeLimits(void);
 void onLedFadeTo(void);
+void onLedFadeOver(void);
+void onLedSetWave(void);
+void onLedSetScene(void);
+void onLedPlayScene(void);
+void onReturnStorageStats(void);
+void onReturnSamples(void);
+void onPushSetDeadband(void);
+void onPushSetHeartbeat(void);
+void onPushReturnConfig(void);
+void onSampleDump(void);
+void onPsSetFilter(void);
+void onPsReturnFilter(void);
+void onAlsVerify(void);
+void onAlsSetRange(void);
+void onAlsReturnRange(void);
+void onReturnWhiteRatio(void);
 void onCalibratePS(void);
 void onSoftReset(void);
+void onReturnProfile(void);
+void onReturnRam(void);
+void onReturnTrace(void);
 //climate sensor
+//command IDs; host/include/sensorhub/Commands.h has the same list
 enum
 {
 	kQStatus,							//0
@@ -155,8 +269,49 @@ enum
 	kSLedCmdFadeTo,				//28
 	kSCalibratePS,				//29
 	kRCalibratePS,				//30
-	kSReset								//31
+	kSReset,							//31
+	kQProfile,						//32
+	kRProfile,						//33
+	kRProfileLoop,				//34
+	kSLedCmdFadeOver,			//35
+	kSLedWave,						//36
+	kRLedWave,						//37
+	kSLedScene,						//38
+	kRLedScene,						//39
+	kSLedScenePlay,				//40
+	kQStorageStats,				//41
+	kRStorageStats,				//42
+	kQSamples,						//43
+	kRSamples,						//44
+	kSPushDeadband,				//45
+	kSPushHeartbeat,			//46
+	kQPushConfig,					//47
+	kRPushConfig,					//48
+	kQSampleDump,					//49
+	kRSampleBlock,				//50
+	kRSampleDumpEnd,			//51
+	kSPsFilter,						//52
+	kQPsFilter,						//53
+	kRPsFilter,						//54
+	kQAlsVerify,					//55
+	kRAlsVerify,					//56
+	kSAlsRange,						//57
+	kQAlsRange,						//58
+	kRAlsRange,						//59
+	kQWhiteRatio,					//60
+	kRWhiteRatio,					//61
+	kQRam,								//62
+	kRRam,								//63
+	kQTrace,							//64
+	kRTrace,							//65
+	kRTraceEnd						//66
 };
+//CmdMessenger drops callbacks attached at or above MAXCALLBACKS
+static_assert(kRTraceEnd < MAXCALLBACKS, "raise MAXCALLBACKS in CmdMessenger.h");
+//a full scene in one kSLedScene, every step byte escaped, behind the line
+//end of the command before; CmdMessenger drops a command that fills its buffer
+static_assert(sizeof("\r\n38,16,255,2") - 1 + LED_SCENE_MAX_STEPS * (1 + 2 * sizeof(LedSceneStep)) <= MESSENGERBUFFERSIZE - 2,
+	"raise MESSENGERBUFFERSIZE in CmdMessenger.h");
 
 void attachCommandCallbacks()
 {
@@ -178,31 +333,106 @@ void attachCommandCallbacks()
 	cmdMessenger.attach(kSLedFadeMinMax, onLedSetFadeLimits);
 	cmdMessenger.attach(kQLedFadeMinMax, onLedReturnFadeLimits);
 	cmdMessenger.attach(kSLedCmdFadeTo, onLedFadeTo);
+	cmdMessenger.attach(kSLedCmdFadeOver, onLedFadeOver);
+	cmdMessenger.attach(kSLedWave, onLedSetWave);
+	cmdMessenger.attach(kSLedScene, onLedSetScene);
+	cmdMessenger.attach(kSLedScenePlay, onLedPlayScene);
+	cmdMessenger.attach(kQStorageStats, onReturnStorageStats);
+	cmdMessenger.attach(kQSamples, onReturnSamples);
+	cmdMessenger.attach(kSPushDeadband, onPushSetDeadband);
+	cmdMessenger.attach(kSPushHeartbeat, onPushSetHeartbeat);
+	cmdMessenger.attach(kQPushConfig, onPushReturnConfig);
+	cmdMessenger.attach(kQSampleDump, onSampleDump);
+	cmdMessenger.attach(kSPsFilter, onPsSetFilter);
+	cmdMessenger.attach(kQPsFilter, onPsReturnFilter);
+	cmdMessenger.attach(kQAlsVerify, onAlsVerify);
+	cmdMessenger.attach(kSAlsRange, onAlsSetRange);
+	cmdMessenger.attach(kQAlsRange, onAlsReturnRange);
+	cmdMessenger.attach(kQWhiteRatio, onReturnWhiteRatio);
 	cmdMessenger.attach(kSCalibratePS, onCalibratePS);
 	cmdMessenger.attach(kSReset, onSoftReset);
+	cmdMessenger.attach(kQRam, onReturnRam);
+#ifdef SYS_PROFILER
+	cmdMessenger.attach(kQProfile, onReturnProfile);
+#endif
+#ifdef SYS_TRACE
+	cmdMessenger.attach(kQTrace, onReturnTrace);
+#endif
 }
 
 //Tasker Functions
 void sysTaskProcessor(void)
 {
+	if (sysSettingsSaving && EEPROM.queueIdle())
+	{
+		sysSettingsSaving = false;
+		cmdMessenger.sendCmd(kRStatus, SYS_SETTINGS_SAVED);
+	}
+	if (EEPROMVarBase::anyDirty() && (millis() - EEPROMVarBase::lastChange()) >= SYS_COMMIT_QUIET_MS)
+	{
+		PROFILE_BEGIN(commit);
+		EEPROMVarBase::commitDirty();
+		if (settingsDirty) {
+			sysSaveSettings();
+		}
+		PROFILE_END(commit, PROFILE_TASK_EEPROM);
+	}
+	//one block per pass so a dump does not hold up the rest of the loop
+	if (sampleDumping) {
+		sampleDumpNext();
+	}
+#ifdef SYS_TRACE
+	if (traceDumping) {
+		traceDumpNext();
+	}
+#endif
+	if (psCalBusy(psCalibration)) {
+		psCalibrationTask();
+	}
+
 	switch (sysTaskFlag) {
 		case SYS_TASK_DEFAULT:
 		{
 			sensorDataReady = false;
 			if (!sensorDataReady) {
+				PROFILE_BEGIN(sensors);
 				if (sensorPollALS) {
-					lux = alsSensor.lux();
+					sensorReadALS();
 				}
-				if (sensorPollPS) {
-					ps = alsSensor.ps();
+				if (sensorPollPS && (millis() - psLast) >= psGap) {
+					psLast = millis();
+					ps = psFilterUpdate(psFilter, alsSensor.ps());
 				}
 				temperature = climateSensor.readTempC();
 				humidity = climateSensor.readHumidity();
 				pressure = climateSensor.readPressure();
+				PROFILE_END(sensors, PROFILE_TASK_SENSORS);
+			}
+			if (millis() - sampleLast >= SAMPLE_PERIOD_MS) {
+				sampleRecord();
 			}
 
 			sensorDataReady = true;
 
+			//once per approach: a hand held in front does not start the scene again
+			if (ledScene.header.trigger == LED_SCENE_TRIGGER_PS && sensorPsCalibrated)
+			{
+				if (ps >= sensorPSTriggerH)
+				{
+					if (!ledScenePsNear && !ledScene.playing) {
+						ledSceneStart(ledScene, ledFadeState, ledLevel, millis());
+					}
+					ledScenePsNear = true;
+				}
+				else if (ps <= sensorPSTriggerL) {
+					ledScenePsNear = false;
+				}
+			}
+			//a playing scene owns the LED until it finishes
+			if (ledScene.playing) {
+				break;
+			}
+
 			switch (ledControlMode){
 				case LED_CONTROL_MODE_ALS:
 					if(!sensorPollALS)
@@ -240,14 +470,28 @@ void sysTaskProcessor(void)
 			if (sensorDataPushed == false)
 			{
 				if (sensorDataReady) {
+					PROFILE_BEGIN(push);
 					sensorDataPushed = true;
-					cmdMessenger.sendCmd(kRTemp, temperature);
-					cmdMessenger.sendCmd(kRHumi, humidity);
-					cmdMessenger.sendCmd(kRPres, pressure);
-					cmdMessenger.sendCmd(kRLux, lux);
-					if (sensorPsCalibrated) {
+					uint32_t now = millis();
+					if (pushDue(SAMPLE_CH_TEMPERATURE, temperature, now)) {
+						cmdMessenger.sendCmd(kRTemp, temperature);
+					}
+					if (pushDue(SAMPLE_CH_HUMIDITY, humidity, now)) {
+						cmdMessenger.sendCmd(kRHumi, humidity);
+					}
+					if (pushDue(SAMPLE_CH_PRESSURE, pressure, now)) {
+						cmdMessenger.sendCmd(kRPres, pressure);
+					}
+					if (pushDue(SAMPLE_CH_LUX, lux, now)) {
+						sensorSendLux();
+					}
+					if (pushDue(PUSH_CH_WHITE_RATIO, whiteRatio, now)) {
+						onReturnWhiteRatio();
+					}
+					if (sensorPsCalibrated && pushDue(SAMPLE_CH_PS, ps, now)) {
 						cmdMessenger.sendCmd(kRPS, ps);
 					}
+					PROFILE_END(push, PROFILE_TASK_PUSH);
 				}
 			}
 
@@ -281,36 +525,36 @@ void sysTaskProcessor(void)
 		}
 		case SYS_TASK_SAVE_SETTINGS:
 		{
+			PROFILE_BEGIN(eeprom);
 			sysSaveSettings();
-			cmdMessenger.sendCmd(kRStatus, SYS_SETTINGS_SAVED);
+			PROFILE_END(eeprom, PROFILE_TASK_EEPROM);
+			sysSettingsSaving = true;
 			sysTaskFlag = SYS_TASK_DEFAULT;
 			break;
 		}
 		case SYS_TASK_CALIBRATE:
 		{
+			//starts the run, psCalibrationTask() carries it on from here; a
+			//request during a run starts it over and keeps what to restore
+			if (!psCalBusy(psCalibration)) {
+				psCalibrationRestore = sensorPsCalibrated;
+			}
 			sensorPsCalibrated = false;
-			uint16_t psCalFactor;
-			if(alsSensor.psSetCanc(0))
+			if (alsSensor.psSetCanc(0))
 			{
-				delay(500);
-				psCalFactor = alsSensor.psCalibrate();
-				if (alsSensor.psSetCanc(psCalFactor)) {
-					psCal = psCalFactor;
-					sensorPsCalibrated = true;
-					cmdMessenger.sendCmd(kRCalibratePS, SYS_PS_CALIBRATED);
-					sysTaskFlag = SYS_TASK_SAVE_SETTINGS;
-				}
-				else
-				{
-					cmdMessenger.sendCmd(kRCalibratePS, SYS_PS_CALIBRATE_FAIL);
-					sysTaskFlag = SYS_TASK_DEFAULT;
-				}
+				psCalStart(psCalibration, millis());
+				cmdMessenger.sendCmdStart(kRCalibratePS);
+				cmdMessenger.sendCmdArg(SYS_PS_CALIBRATING);
+				cmdMessenger.sendCmdArg(0);
+				cmdMessenger.sendCmdArg(PS_CAL_SAMPLES);
+				cmdMessenger.sendCmdEnd();
 			}
 			else
 			{
+				psCalibration.state = PS_CAL_FAIL;
 				cmdMessenger.sendCmd(kRCalibratePS, SYS_PS_CALIBRATE_FAIL);
-				sysTaskFlag = SYS_TASK_DEFAULT;
 			}
+			sysTaskFlag = SYS_TASK_DEFAULT;
 			break;
 		}
 		default:
@@ -323,14 +567,19 @@ void sysTaskProcessor(void)
 
 void sysTaskTimer(void)
 {
+	PROFILE_ISR_BEGIN();
   sysTaskCounter++;
 
+	if (ledWave.active) {
+		Timer1.setPwmDuty16(LEDPIN, ledCieDuty16(ledWaveLevel(ledWave)));
+	}
+
 	if (sysTaskCounter % 10 == 0) {
 		ledFadeFlag = true;
 		//sleep_disable();
 	}
 
-	if ((sysTaskCounter % sysDataPushInterval == 0) && (sysDataPushMode > 0)) {
+	if ((sysTaskCounter % sysDataPushInterval == 0) && (sysDataPushMode != SYS_PUSH_MODE_OFF)) {
 		sensorDataPushed = false;
 		sysTaskFlag = SYS_TASK_PUSH_DATA;
 	}
@@ -340,12 +589,180 @@ void sysTaskTimer(void)
     ledPSTimedout = true;
 		//sleep_disable();
   }
+	PROFILE_ISR_END();
+}
+
+//in exception mode a channel goes out once it has moved past its deadband
+//since it was last sent, or when the heartbeat runs out
+bool pushDue(uint8_t channel, uint32_t value, uint32_t now)
+{
+	uint32_t last = pushLastValue[channel];
+	uint32_t delta = (value > last) ? value - last : last - value;
+	if (sysDataPushMode != SYS_PUSH_MODE_EXCEPTION || !(pushSent & _BV(channel)) || delta > pushDeadband[channel] ||
+		(pushHeartbeat != 0 && (now - pushLastSent[channel]) >= (uint32_t)pushHeartbeat * 1000))
+	{
+		pushLastValue[channel] = value;
+		pushLastSent[channel] = now;
+		pushSent |= _BV(channel);
+		return true;
+	}
+	pushSuppressed++;
+	return false;
+}
+
+//lux stays in whole lux for the night light and the history
+void sensorReadALS(void)
+{
+	if (alsSensor.alsRead(luxMilli, white)) {
+		lux = luxMilli / 1000;
+		whiteRatio = alsSensor.whiteRatio();
+	}
+	else {
+		lux = 0xFFFF;
+	}
 }
 
+//lux, then the ALS range it was read in and the reading in mlux
+void sensorSendLux(void)
+{
+	cmdMessenger.sendCmdStart(kRLux);
+	cmdMessenger.sendCmdArg(lux);
+	cmdMessenger.sendCmdArg(alsSensor.alsRange());
+	cmdMessenger.sendCmdArg(luxMilli);
+	cmdMessenger.sendCmdEnd();
+}
+
+void alsApplyRange(void)
+{
+	alsSensor.alsSetAuto(alsRangeMode == ALS_RANGE_AUTO);
+	if (alsRangeMode != ALS_RANGE_AUTO) {
+		alsSensor.alsSetRange(alsRangeMode);
+	}
+}
+
+void sampleRecord(void)
+{
+	uint16_t values[SAMPLE_CHANNELS];
+	sampleLast = millis();
+	values[SAMPLE_CH_TEMPERATURE] = temperature;
+	values[SAMPLE_CH_HUMIDITY] = humidity;
+	values[SAMPLE_CH_PRESSURE] = samplePressure(pressure);
+	values[SAMPLE_CH_LUX] = lux;
+	values[SAMPLE_CH_PS] = ps;
+	samplePush(sampleRing, (uint16_t)(sampleLast / 1000), values);
+}
+
+//takes the next calibration reading when it is due and reports progress;
+//SYS_PS_CALIBRATING with the readings taken, then SYS_PS_CALIBRATED with
+//the level and variance, or SYS_PS_CALIBRATE_FAIL with the variance
+void psCalibrationTask(void)
+{
+	uint32_t now = millis();
+	if (!psCalDue(psCalibration, now)) {
+		return;
+	}
+	PROFILE_BEGIN(calibrate);
+	uint8_t state = psCalAdd(psCalibration, alsSensor.ps(), now);
+	if (state == PS_CAL_SAMPLE)
+	{
+		cmdMessenger.sendCmdStart(kRCalibratePS);
+		cmdMessenger.sendCmdArg(SYS_PS_CALIBRATING);
+		cmdMessenger.sendCmdArg(psCalibration.count);
+		cmdMessenger.sendCmdArg(PS_CAL_SAMPLES);
+		cmdMessenger.sendCmdEnd();
+	}
+	else if (state == PS_CAL_DONE && alsSensor.psSetCanc(psCalibration.result))
+	{
+		psCal = psCalibration.result;
+		sensorPsCalibrated = true;
+		//readings from before the new cancellation would skew the filter
+		psFilterInit(psFilter, psFilterMedianN, psFilterShift);
+		cmdMessenger.sendCmdStart(kRCalibratePS);
+		cmdMessenger.sendCmdArg(SYS_PS_CALIBRATED);
+		cmdMessenger.sendCmdArg(psCal);
+		cmdMessenger.sendCmdArg(psCalibration.variance);
+		cmdMessenger.sendCmdEnd();
+		sysTaskFlag = SYS_TASK_SAVE_SETTINGS;
+	}
+	else
+	{
+		//too noisy or the sensor stopped answering; the old cancellation is
+		//gone, so restore it rather than run uncancelled
+		psCalibration.state = PS_CAL_FAIL;
+		if (psCalibrationRestore && alsSensor.psSetCanc(psCal)) {
+			sensorPsCalibrated = true;
+		}
+		cmdMessenger.sendCmdStart(kRCalibratePS);
+		cmdMessenger.sendCmdArg(SYS_PS_CALIBRATE_FAIL);
+		cmdMessenger.sendCmdArg(psCalibration.variance);
+		cmdMessenger.sendCmdEnd();
+	}
+	PROFILE_END(calibrate, PROFILE_TASK_CALIBRATE);
+}
+
+void sampleDumpNext(void)
+{
+	uint8_t block[SAMPLE_DUMP_BLOCK_MAX];
+	uint8_t len = (sampleDumpBlocks > 0) ? sampleDumpBlock(sampleRing, sampleDumpSeq, block) : 0;
+	if (len == 0)
+	{
+		//the hub resumes from the first argument; a total below it means the node restarted
+		sampleDumping = false;
+		cmdMessenger.sendCmdStart(kRSampleDumpEnd);
+		cmdMessenger.sendCmdArg(sampleDumpSeq);
+		cmdMessenger.sendCmdArg(sampleDumpOldest(sampleRing));
+		cmdMessenger.sendCmdArg(sampleRing.total);
+		cmdMessenger.sendCmdEnd();
+		return;
+	}
+	cmdMessenger.sendCmdStart(kRSampleBlock);
+	cmdMessenger.sendCmdBinArg(block, len);
+	cmdMessenger.sendCmdEnd();
+	//the block may have started later than asked if samples had been overwritten
+	uint32_t first = 0;
+	for (uint8_t i = 0; i < 4; i++) {
+		first |= (uint32_t)block[3 + i] << (8 * i);
+	}
+	sampleDumpSeq = first + block[2];
+	sampleDumpBlocks--;
+}
+
+#ifdef SYS_TRACE
+//one frame per pass like the sample dump; frames that arrive meanwhile stay
+//in the ring for the next kQTrace
+void traceDumpNext(void)
+{
+	uint8_t header;
+	uint32_t time;
+	uint8_t frame[TRACE_FRAME_MAX];
+	traceStream.hold(true);
+	if (traceRing.marked && traceRingTake(traceRing, header, time, frame))
+	{
+		traceRing.marked--;
+		cmdMessenger.sendCmdStart(kRTrace);
+		cmdMessenger.sendCmdArg(time);
+		cmdMessenger.sendCmdArg((header & TRACE_FLAG_OUT) ? TRACE_OUT : TRACE_IN);
+		cmdMessenger.sendCmdArg((header & TRACE_FLAG_TRUNCATED) ? 1 : 0);
+		cmdMessenger.sendCmdBinArg(frame, header & TRACE_LENGTH_MASK);
+		cmdMessenger.sendCmdEnd();
+	}
+	else
+	{
+		traceDumping = false;
+		cmdMessenger.sendCmdStart(kRTraceEnd);
+		cmdMessenger.sendCmdArg(traceRing.dropped);
+		cmdMessenger.sendCmdArg(millis());
+		cmdMessenger.sendCmdEnd();
+		traceRing.dropped = 0;
+	}
+	traceStream.hold(false);
+}
+#endif
+
 //system settings
 void sysLoadDefault(void)
 {
-  sysDataPushMode = ON;
+  sysDataPushMode = SYS_PUSH_MODE_ALL;
   sysDataPushInterval = 10000;
   ledControlMode = LED_CONTROL_MODE_ALS_PS;
   ledFadeTargetMin = 0;
@@ -354,34 +771,88 @@ void sysLoadDefault(void)
 
 void sysLoadSettings(void)
 {
+	Settings settings;
 	sysLoadDefault();
-	uint8_t settingsSaved = EEPROM.read(0);
-	if (settingsSaved==1) {
-		sysDataPushMode = EEPROM.read(4);
-	  sysDataPushInterval = EEPROM.readInt(6);
-		ledControlMode = EEPROM.read(10);
-	  ledFadeTargetMin = EEPROM.read(12);
-	  ledFadeTargetMax = EEPROM.read(14);
-		sensorPsCalibrated = EEPROM.read(16);
-		psCal = EEPROM.readInt(18);
+	EEPROM.journalBegin(SETTINGS_JOURNAL_ADDR, SETTINGS_JOURNAL_SIZE, sizeof(Settings));
+	if (EEPROM.journalReadBlock<Settings>(settings) && settingsValid(settings))
+	{
+		sysDataPushMode = settings.dataPushMode;
+		sysDataPushInterval = settings.dataPushInterval;
+		sensorPsCalibrated = settings.psCalibrated;
+		psCal = settings.psCal;
+		ledControlMode.load(settings.ledControlMode);
+		ledFadeTargetMin.load(settings.ledFadeTargetMin);
+		ledFadeTargetMax.load(settings.ledFadeTargetMax);
+		for (uint8_t i = 0; i < PUSH_CHANNELS; i++) {
+			pushDeadband[i].load(settings.pushDeadband[i]);
+		}
+		pushHeartbeat.load(settings.pushHeartbeat);
+		psFilterMedianN.load(settings.psFilterMedianN);
+		psFilterShift.load(settings.psFilterShift);
+		alsRangeMode.load(settings.alsRangeMode);
+		//anything out of range goes back to its default, and is saved again
+		if (ledControlMode > LED_CONTROL_MODE_OFF || ledFadeTargetMin > ledFadeTargetMax || ledFadeTargetMax > 100)
+		{
+			ledControlMode = LED_CONTROL_MODE_ALS_PS;
+			ledFadeTargetMin = 0;
+			ledFadeTargetMax = 100;
+		}
+		if (!psFilterValid(psFilterMedianN, psFilterShift))
+		{
+			psFilterMedianN = 3;
+			psFilterShift = 2;
+		}
+		if (alsRangeMode > ALS_RANGE_AUTO) {
+			alsRangeMode = ALS_RANGE_AUTO;
+		}
+	}
+	else if (EEPROM.read(SETTINGS_LEGACY_FLAG_ADDR) == SETTINGS_LEGACY_FLAG)
+	{
+		sysLoadLegacySettings();
+		sysSaveSettings();
+		EEPROM.updateByte(SETTINGS_LEGACY_FLAG_ADDR, 0);
 	}
 	else
 	{
-		sysLoadDefault();
+		//blank or corrupt, start over from the defaults
 		sysSaveSettings();
 	}
 }
 
+void sysLoadLegacySettings(void)
+{
+	sysDataPushMode = EEPROM.read(4);
+  sysDataPushInterval = EEPROM.readInt(6);
+	ledControlMode = EEPROM.read(10);
+  ledFadeTargetMin = EEPROM.read(12);
+  ledFadeTargetMax = EEPROM.read(14);
+	sensorPsCalibrated = EEPROM.read(16);
+	psCal = EEPROM.readInt(18);
+}
+
+//commits the SettingsVars first, so none of them is left to save again
 void sysSaveSettings(void)
 {
-	EEPROM.updateByte(4, sysDataPushMode);
-	EEPROM.updateInt(6, sysDataPushInterval);
-	EEPROM.updateByte(10, ledControlMode);
-	EEPROM.updateByte(12, ledFadeTargetMin);
-	EEPROM.updateByte(14, ledFadeTargetMax);
-	EEPROM.updateByte(16, sensorPsCalibrated);
-	EEPROM.updateInt(18, psCal);
-	EEPROM.updateByte(0, 1);
+	EEPROMVarBase::commitDirty();
+	settingsDirty = false;
+	Settings settings;
+	settings.version = SETTINGS_VERSION;
+	settings.dataPushMode = sysDataPushMode;
+	settings.dataPushInterval = sysDataPushInterval;
+	settings.ledControlMode = ledControlMode;
+	settings.ledFadeTargetMin = ledFadeTargetMin;
+	settings.ledFadeTargetMax = ledFadeTargetMax;
+	settings.psCalibrated = sensorPsCalibrated;
+	settings.psCal = psCal;
+	for (uint8_t i = 0; i < PUSH_CHANNELS; i++) {
+		settings.pushDeadband[i] = pushDeadband[i];
+	}
+	settings.pushHeartbeat = pushHeartbeat;
+	settings.psFilterMedianN = psFilterMedianN;
+	settings.psFilterShift = psFilterShift;
+	settings.alsRangeMode = alsRangeMode;
+	settings.crc = settingsCrc(settings);
+	EEPROM.journalWriteBlock<Settings>(settings, true);
 }
 
 uint16_t sysBootTest(void)
@@ -426,34 +897,61 @@ void ledPSControl()
 //LED Control Functions
 void ledController(void)
 {
+	if (ledControlMode == LED_CONTROL_MODE_BREATHE)
+	{
+		//the waveform runs from sysTaskTimer, nothing to do here
+		ledScene.playing = false;
+		if (!ledWave.active) {
+			ledWaveApply();
+			ledWave.phase = 0;
+			ledWave.active = true;
+		}
+		ledFadeFlag = false;
+		return;
+	}
+	if (ledWave.active)
+	{
+		//hand the output back to the fade engine where the waveform left it
+		ledWave.active = false;
+		ledLevel = ledWave.level;
+		ledFade = (ledLevel + 128) >> 8;
+		ledFadeState.to = 0xFFFF;
+	}
+
 	if (ledFadeFlag==true)
 	{
-		if (ledFade < ledFadeTarget)
+		uint32_t now = millis();
+		if (ledScene.playing)
 		{
-			ledFade++;
+			ledSceneUpdate(ledScene, ledFadeState, ledLevel, now);
+			ledFadeTarget = ledFadeState.to >> 8;
 		}
-		else if (ledFade > ledFadeTarget)
+		//a new target set by the night light logic fades at the default rate
+		if (LED_LEVEL(ledFadeTarget) != ledFadeState.to)
 		{
-			ledFade--;
+			uint8_t distance = (ledFade < ledFadeTarget) ? ledFadeTarget - ledFade : ledFade - ledFadeTarget;
+			ledFadeStart(ledFadeState, ledLevel, LED_LEVEL(ledFadeTarget), distance * LED_FADE_STEP_MS, LED_CURVE_LINEAR, now);
 		}
-		ledFadeTo(LEDPIN, ledFade);
+		ledLevel = ledFadeLevel(ledFadeState, now);
+		ledFade = (ledLevel + 128) >> 8;
+		ledFadeTo(LEDPIN, ledLevel);
 		ledFadeFlag = false;
 	}
+}
 
-	if (ledControlMode == LED_CONTROL_MODE_BREATHE) {
-		if (ledFade==0) {
-			ledFadeTarget = 100;
-		}
-		if (ledFade==100) {
-			ledFadeTarget = 0;
-		}
+void ledWaveApply(void)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		ledWaveSet(ledWave, ledWaveShape, ledWavePeriod, SYS_TICK_PERIOD, ledWaveAmplitude,
+			LED_LEVEL(ledFadeTargetMin), LED_LEVEL(ledFadeTargetMax));
 	}
 }
 
-void ledFadeTo(uint8_t pin, uint8_t brightness)
+void ledFadeTo(uint8_t pin, uint16_t level)
 {
-	if (brightness >=ledFadeTargetMin && brightness <=ledFadeTargetMax) {
-		Timer1.setPwmDuty(pin, pgm_read_word(&(cie[brightness])));
+	if (level >= LED_LEVEL(ledFadeTargetMin) && level <= LED_LEVEL(ledFadeTargetMax)) {
+		Timer1.setPwmDuty16(pin, ledCieDuty16(level));
 	}
 }
 
@@ -478,7 +976,11 @@ void onSaveSettings()
 
 void onDataSetPushMode()
 {
-	sysDataPushMode = cmdMessenger.readBoolArg();
+	uint8_t mode = (uint8_t)cmdMessenger.readInt16Arg();
+	if (mode <= SYS_PUSH_MODE_EXCEPTION) {
+		sysDataPushMode = mode;
+		pushSent = 0;
+	}
 	onDataReturnPushMode();
 }
 void onDataReturnPushMode()
@@ -509,8 +1011,8 @@ void onReturnPresQuery()
 }
 void onReturnLuxQuery()
 {
-	lux = alsSensor.lux();
-	cmdMessenger.sendCmd(kRLux, lux);
+	sensorReadALS();
+	sensorSendLux();
 }
 void onReturnPSQuery(){
 	cmdMessenger.sendCmd(kRPS, alsSensor.ps());
@@ -533,7 +1035,7 @@ void onLedSetMode()
 
 void onLedReturnMode()
 {
-	cmdMessenger.sendCmd(kRLedMode, ledControlMode);
+	cmdMessenger.sendCmd(kRLedMode, (uint8_t)ledControlMode);
 }
 
 void onLedRestoreMode()
@@ -555,18 +1057,223 @@ void onLedSetFadeLimits()
 	{
 		ledFadeTargetMax = upper;
 	}
+	if (ledWave.active) {
+		ledWaveApply();
+	}
 	onLedReturnFadeLimits();
 }
 void onLedReturnFadeLimits()
 {
 	cmdMessenger.sendCmdStart(kRLedFadeMinMax);
-	cmdMessenger.sendCmdArg(ledFadeTargetMin);
-	cmdMessenger.sendCmdArg(ledFadeTargetMax);
+	cmdMessenger.sendCmdArg((uint8_t)ledFadeTargetMin);
+	cmdMessenger.sendCmdArg((uint8_t)ledFadeTargetMax);
 	cmdMessenger.sendCmdEnd();
 }
+//percent, anything past 100 is ignored
 void onLedFadeTo()
 {
-	ledFadeTarget = (uint8_t)cmdMessenger.readInt16Arg();
+	uint16_t target = (uint16_t)cmdMessenger.readInt16Arg();
+	if (target <= 100) {
+		ledFadeTarget = target;
+	}
+}
+void onLedFadeOver()
+{
+	uint16_t target = (uint16_t)cmdMessenger.readInt16Arg();
+	uint16_t duration = (uint16_t)cmdMessenger.readInt32Arg();
+	uint8_t curve = (uint8_t)cmdMessenger.readInt16Arg();
+	if (target <= 100)
+	{
+		ledFadeTarget = target;
+		ledFadeStart(ledFadeState, ledLevel, LED_LEVEL(target), duration, curve, millis());
+	}
+}
+void onLedSetWave()
+{
+	uint8_t shape = (uint8_t)cmdMessenger.readInt16Arg();
+	uint16_t period = (uint16_t)cmdMessenger.readInt32Arg();
+	uint8_t amplitude = (uint8_t)cmdMessenger.readInt16Arg();
+	if (shape < LED_WAVE_COUNT && period > 0 && amplitude <= 100)
+	{
+		ledWaveShape = shape;
+		ledWavePeriod = period;
+		ledWaveAmplitude = amplitude;
+		if (ledWave.active) {
+			ledWaveApply();
+		}
+	}
+	cmdMessenger.sendCmdStart(kRLedWave);
+	cmdMessenger.sendCmdArg(ledWaveShape);
+	cmdMessenger.sendCmdArg(ledWavePeriod);
+	cmdMessenger.sendCmdArg(ledWaveAmplitude);
+	cmdMessenger.sendCmdEnd();
+}
+void onLedSetScene()
+{
+	LedSceneHeader header;
+	header.magic = LED_SCENE_MAGIC;
+	header.count = (uint8_t)cmdMessenger.readInt16Arg();
+	header.loops = (uint8_t)cmdMessenger.readInt16Arg();
+	header.trigger = (uint8_t)cmdMessenger.readInt16Arg();
+	if (header.count > 0 && header.count <= LED_SCENE_MAX_STEPS)
+	{
+		ledScene.playing = false;
+		//invalidate the stored scene first so a reset mid upload leaves nothing half written
+		EEPROM.updateByte(LED_SCENE_ADDR, 0);
+		for (uint8_t i = 0; i < header.count; i++)
+		{
+			LedSceneStep step = cmdMessenger.readBinArg<LedSceneStep>();
+			EEPROM.updateBlock<LedSceneStep>(ledSceneStepAddr(i), step);
+		}
+		EEPROM.updateBlock<LedSceneHeader>(LED_SCENE_ADDR, header);
+		ledScene.header = header;
+	}
+	else
+	{
+		header.count = 0;
+	}
+	cmdMessenger.sendCmd(kRLedScene, header.count);
+}
+void onLedPlayScene()
+{
+	if (cmdMessenger.readBoolArg()) {
+		ledSceneStart(ledScene, ledFadeState, ledLevel, millis());
+	}
+	else {
+		ledScene.playing = false;
+	}
+}
+void onReturnStorageStats()
+{
+	cmdMessenger.sendCmdStart(kRStorageStats);
+	cmdMessenger.sendCmdArg(EEPROM.journalSlots());
+	cmdMessenger.sendCmdArg(EEPROM.journalSequence());
+	cmdMessenger.sendCmdArg(EEPROM.journalCycles());
+	cmdMessenger.sendCmdArg(EEPROM.journalBytesWritten() + EEPROM.queueBytesWritten());
+	cmdMessenger.sendCmdEnd();
+}
+//channel, window in seconds (0 for all), number of recent values to list
+void onReturnSamples()
+{
+	uint8_t channel = (uint8_t)cmdMessenger.readInt16Arg();
+	uint16_t window = (uint16_t)cmdMessenger.readInt32Arg();
+	uint8_t last = (uint8_t)cmdMessenger.readInt16Arg();
+	SampleStats stats;
+	if (channel < SAMPLE_CHANNELS) {
+		sampleStats(sampleRing, channel, sampleWindow(sampleRing, (uint16_t)(millis() / 1000), window), stats);
+	}
+	else {
+		//no such channel, answer with nothing in it rather than leave the hub waiting
+		sampleStats(sampleRing, 0, 0, stats);
+	}
+	if (last > stats.count) {
+		last = stats.count;
+	}
+	cmdMessenger.sendCmdStart(kRSamples);
+	cmdMessenger.sendCmdArg(channel);
+	cmdMessenger.sendCmdArg(stats.count);
+	cmdMessenger.sendCmdArg(stats.min);
+	cmdMessenger.sendCmdArg(stats.max);
+	cmdMessenger.sendCmdArg(stats.mean);
+	for (uint8_t i = 0; i < last; i++) {
+		cmdMessenger.sendCmdArg(sampleAt(sampleRing, i).value[channel]);
+	}
+	cmdMessenger.sendCmdEnd();
+}
+//channel, deadband
+void onPushSetDeadband()
+{
+	uint8_t channel = (uint8_t)cmdMessenger.readInt16Arg();
+	uint16_t deadband = (uint16_t)cmdMessenger.readInt32Arg();
+	if (channel < PUSH_CHANNELS) {
+		pushDeadband[channel] = deadband;
+	}
+	onPushReturnConfig();
+}
+void onPushSetHeartbeat()
+{
+	pushHeartbeat = (uint16_t)cmdMessenger.readInt32Arg();
+	onPushReturnConfig();
+}
+//heartbeat, the deadband of each channel, pushes suppressed since boot
+void onPushReturnConfig()
+{
+	cmdMessenger.sendCmdStart(kRPushConfig);
+	cmdMessenger.sendCmdArg((uint16_t)pushHeartbeat);
+	for (uint8_t i = 0; i < PUSH_CHANNELS; i++) {
+		cmdMessenger.sendCmdArg((uint16_t)pushDeadband[i]);
+	}
+	cmdMessenger.sendCmdArg(pushSuppressed);
+	cmdMessenger.sendCmdEnd();
+}
+//first sequence number wanted, most blocks to send (0 for all)
+void onSampleDump()
+{
+	sampleDumpSeq = (uint32_t)cmdMessenger.readInt32Arg();
+	sampleDumpBlocks = (uint8_t)cmdMessenger.readInt16Arg();
+	if (sampleDumpBlocks == 0) {
+		sampleDumpBlocks = 0xFF;
+	}
+	sampleDumping = true;
+}
+//median window (1, 3 or 5), EMA shift (0..6)
+void onPsSetFilter()
+{
+	uint8_t median = (uint8_t)cmdMessenger.readInt16Arg();
+	uint8_t shift = (uint8_t)cmdMessenger.readInt16Arg();
+	if (psFilterValid(median, shift))
+	{
+		psFilterMedianN = median;
+		psFilterShift = shift;
+		psFilterInit(psFilter, median, shift);
+	}
+	onPsReturnFilter();
+}
+void onPsReturnFilter()
+{
+	cmdMessenger.sendCmdStart(kRPsFilter);
+	cmdMessenger.sendCmdArg((uint8_t)psFilterMedianN);
+	cmdMessenger.sendCmdArg((uint8_t)psFilterShift);
+	cmdMessenger.sendCmdEnd();
+}
+//reads back the VCNL4040 configuration into the driver's shadow; replies
+//with whether every register could be read, a bit per register that did
+//not match the shadow, and the bus writes skipped since boot
+void onAlsVerify()
+{
+	uint8_t mismatch;
+	bool ok = alsSensor.verify(mismatch);
+	cmdMessenger.sendCmdStart(kRAlsVerify);
+	cmdMessenger.sendCmdArg(ok);
+	cmdMessenger.sendCmdArg(mismatch);
+	cmdMessenger.sendCmdArg(alsSensor.writesSkipped());
+	cmdMessenger.sendCmdEnd();
+}
+//0..3 fixes the ALS integration time at 80..640 ms, ALS_RANGE_AUTO picks it
+void onAlsSetRange()
+{
+	uint8_t mode = (uint8_t)cmdMessenger.readInt16Arg();
+	if (mode <= ALS_RANGE_AUTO)
+	{
+		alsRangeMode = mode;
+		alsApplyRange();
+	}
+	onAlsReturnRange();
+}
+void onAlsReturnRange()
+{
+	cmdMessenger.sendCmdStart(kRAlsRange);
+	cmdMessenger.sendCmdArg((uint8_t)alsRangeMode);
+	cmdMessenger.sendCmdArg(alsSensor.alsRange());
+	cmdMessenger.sendCmdEnd();
+}
+//white ratio, then the WHITE counts it came from
+void onReturnWhiteRatio()
+{
+	cmdMessenger.sendCmdStart(kRWhiteRatio);
+	cmdMessenger.sendCmdArg(whiteRatio);
+	cmdMessenger.sendCmdArg(white);
+	cmdMessenger.sendCmdEnd();
 }
 void onCalibratePS()
 {
@@ -576,9 +1283,66 @@ void onSoftReset()
 {
 	soft_restart();
 }
+//low-water mark, free now, .data plus .bss, then the big static buffers:
+//CmdMessenger's command and stream buffers and callback list, Serial RX
+//and TX, Wire (two in TwoWire, three in twi.c) and the sample ring
+void onReturnRam()
+{
+	cmdMessenger.sendCmdStart(kRRam);
+	cmdMessenger.sendCmdArg(ramLowWater());
+	cmdMessenger.sendCmdArg(ramFree());
+	cmdMessenger.sendCmdArg(ramStatic());
+	cmdMessenger.sendCmdArg(MESSENGERBUFFERSIZE);
+	cmdMessenger.sendCmdArg(MAXSTREAMBUFFERSIZE);
+	cmdMessenger.sendCmdArg(MAXCALLBACKS * sizeof(messengerCallbackFunction));
+	cmdMessenger.sendCmdArg(RAM_SERIAL_RX_BUFFER);
+	cmdMessenger.sendCmdArg(RAM_SERIAL_TX_BUFFER);
+	cmdMessenger.sendCmdArg(5 * BUFFER_LENGTH);
+	cmdMessenger.sendCmdArg(sizeof(sampleRing));
+	cmdMessenger.sendCmdEnd();
+}
+
+#ifdef SYS_TRACE
+//frames go out as kRTrace: start time (ms), direction (0 in, 1 out),
+//truncated, the frame as a binary argument. kRTraceEnd closes the dump with
+//the frames lost to a full ring since the last one and the time now.
+void onReturnTrace()
+{
+	traceRing.marked = traceRing.frames;
+	traceDumping = true;
+}
+#endif
+
+#ifdef SYS_PROFILER
+void onReturnProfile()
+{
+	bool reset = cmdMessenger.readBoolArg();
+	for (uint8_t i = 0; i < PROFILE_TASK_COUNT; i++)
+	{
+		cmdMessenger.sendCmdStart(kRProfile);
+		cmdMessenger.sendCmdArg(i);
+		cmdMessenger.sendCmdArg(profileTasks[i].count);
+		cmdMessenger.sendCmdArg(profileTasks[i].count ? profileTasks[i].min : 0);
+		cmdMessenger.sendCmdArg(profileMean(i));
+		cmdMessenger.sendCmdArg(profileTasks[i].max);
+		cmdMessenger.sendCmdEnd();
+	}
+	cmdMessenger.sendCmdStart(kRProfileLoop);
+	cmdMessenger.sendCmdArg(profileIsrMax);
+	for (uint8_t i = 0; i < PROFILE_HIST_BUCKETS; i++)
+	{
+		cmdMessenger.sendCmdArg(profileLoopHist[i]);
+	}
+	cmdMessenger.sendCmdEnd();
+	if (reset) {
+		profileReset();
+	}
+}
+#endif
 
 void setup()
 {
+	PROFILE_INIT();
 	delay(1000);
 	Serial.begin(38400);
 	sysStatus = sysBootTest();
@@ -602,27 +1366,46 @@ void setup()
 		alsSensor.psConf(0x0E, 0x08, 0, 0x07);
 		alsSensor.ps();
 		alsSensor.lux();
+		//a little over one conversion, so the filter never sees the same one twice;
+		//the sensor runs on its own oscillator
+		uint32_t psPeriod = alsSensor.psPeriod();
+		psGap = (psPeriod + psPeriod / 8 + 999) / 1000;
 	}
 
-	Timer1.initialize(400);
-	Timer1.attachInterrupt(sysTaskTimer);
+	Timer1.initialize(LED_PWM_PERIOD);
 	Timer1.pwm(LEDPIN, 0);
+	Timer2.initialize(SYS_TICK_PERIOD);
+	Timer2.attachInterrupt(sysTaskTimer);
 
 	sysLoadSettings();
+	psFilterInit(psFilter, psFilterMedianN, psFilterShift);
+	alsApplyRange();
 	if (sensorPsCalibrated) {
 		alsSensor.psSetCanc(psCal);
-		ps=alsSensor.ps();
-		lux=alsSensor.lux();
+		ps=psFilterUpdate(psFilter, alsSensor.ps());
+		psLast = millis();
+		sensorReadALS();
+	}
+	if (ledSceneLoad(ledScene) && ledScene.header.trigger == LED_SCENE_TRIGGER_BOOT) {
+		ledSceneStart(ledScene, ledFadeState, ledLevel, millis());
 	}
 	cmdMessenger.printLfCr();
 	attachCommandCallbacks();
 	cmdMessenger.sendCmd(kRStatus,sysStatus);
+#ifdef SYS_BENCH
+	benchRun();
+#endif
 }
 
 void loop()
 {
+	PROFILE_LOOP();
+	PROFILE_BEGIN(serial);
 	cmdMessenger.feedinSerialData();
+	PROFILE_END(serial, PROFILE_TASK_SERIAL);
+	PROFILE_BEGIN(led);
 	ledController();
+	PROFILE_END(led, PROFILE_TASK_LED);
 	sysTaskProcessor();
 	//set_sleep_mode(SLEEP_MODE_IDLE);
 	//sleep_enable();
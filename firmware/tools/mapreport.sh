@@ -0,0 +1,102 @@
+#!/bin/sh
+#
+# mapreport.sh - static RAM per module, from the linker map
+#
+#   pio run -e tinylily && tools/mapreport.sh [-r ram] [map]
+#
+#   -r BYTES  SRAM on the part, 2048 on the ATmega328P
+#
+# Adds up what each object file puts in .data and .bss (.noinit counts as
+# .bss) and lists the modules by total, biggest first. Objects pulled out of
+# an archive are named by the member. What is left of the RAM after .data
+# and .bss is shared by the heap and the stack; the kQRam command reports how
+# much of it the stack has actually used.
+
+RAM=2048
+
+while getopts r: opt
+do
+	case $opt in
+		r) RAM=$OPTARG ;;
+		*) echo "usage: mapreport.sh [-r ram] [map]" >&2; exit 2 ;;
+	esac
+done
+shift $((OPTIND - 1))
+map=${1:-.pio/build/tinylily/firmware.map}
+
+if [ ! -f "$map" ]; then
+	echo "mapreport.sh: no $map, build it with: pio run -e tinylily" >&2
+	exit 2
+fi
+
+awk -v ram="$RAM" '
+	# strtonum is gawk only
+	function hex(s,    i, n) {
+		s = tolower(substr(s, 3))
+		n = 0
+		for (i = 1; i <= length(s); i++)
+			n = n * 16 + index("0123456789abcdef", substr(s, i, 1)) - 1
+		return n
+	}
+	function module(path) {
+		# lib.a(member.o) is named by the member
+		if (match(path, /\(.*\)$/))
+			path = substr(path, RSTART + 1, RLENGTH - 2)
+		sub(/.*\//, "", path)
+		sub(/\.o$/, "", path)
+		return path
+	}
+	function add(size, path) {
+		if (sect == "" || path == "") return
+		size = hex(size)
+		if (size == 0) return
+		m = module(path)
+		used[m, sect] += size
+		total[m] += size
+		sum[sect] += size
+	}
+	/^Linker script and memory map/ { inmap = 1; next }
+	!inmap { next }
+	# an output section: column 0, then address and size if they fit
+	/^\.[A-Za-z_]/ {
+		sect = ""
+		if ($1 == ".data") sect = "data"
+		else if ($1 == ".bss" || $1 == ".noinit") sect = "bss"
+		pending = 0
+		next
+	}
+	# an input section, with address, size and file on the same line or,
+	# when the name is long, on the next one
+	/^ [.A-Za-z*]/ {
+		pending = 0
+		if ($1 ~ /^\*/) next
+		if (NF == 1) { pending = 1; next }
+		if (NF >= 4 && $2 ~ /^0x/ && $3 ~ /^0x/) add($3, $4)
+		next
+	}
+	pending && NF == 3 && $1 ~ /^0x/ && $2 ~ /^0x/ { add($2, $3) }
+	{ pending = 0 }
+	END {
+		if (!inmap) {
+			print "mapreport.sh: not a GNU ld map file" > "/dev/stderr"
+			exit 1
+		}
+		n = 0
+		for (m in total) names[++n] = m
+		# insertion sort by total, biggest first; a map has few enough modules
+		for (i = 2; i <= n; i++) {
+			m = names[i]
+			for (j = i - 1; j > 0 && total[names[j]] < total[m]; j--)
+				names[j + 1] = names[j]
+			names[j + 1] = m
+		}
+		printf "%-28s %6s %6s %6s\n", "module", ".data", ".bss", "total"
+		for (i = 1; i <= n; i++) {
+			m = names[i]
+			printf "%-28s %6d %6d %6d\n", m, used[m, "data"], used[m, "bss"], total[m]
+		}
+		static = sum["data"] + sum["bss"]
+		printf "%-28s %6d %6d %6d\n", "all", sum["data"], sum["bss"], static
+		printf "%d of %d bytes left for the heap and the stack\n", ram - static, ram
+	}
+' "$map"
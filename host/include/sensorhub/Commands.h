@@ -0,0 +1,90 @@
+#ifndef SENSORHUB_COMMANDS_H
+#define SENSORHUB_COMMANDS_H
+
+#include <cstdint>
+
+// The CmdMessenger command IDs of the firmware, see the enum in
+// firmware/src/main.cpp. kQ are queries, kR their replies and pushes, kS
+// set something. Keep the two lists in step.
+
+namespace sensorhub {
+
+enum Command : uint8_t
+{
+	kQStatus = 0,
+	kRStatus = 1,
+	kQDeviceInfo = 2,
+	kRDeviceInfo = 3,
+	kSSaveSettings = 4,
+	kSDataPushMode = 5,
+	kQDataPushMode = 6,
+	kRDataPushMode = 7,
+	kSDataQueryInt = 8,
+	kQDataQueryInt = 9,
+	kRDataQueryInt = 10,
+	kQTemp = 11,
+	kRTemp = 12,
+	kQHumi = 13,
+	kRHumi = 14,
+	kQPres = 15,
+	kRPres = 16,
+	kQLux = 17,
+	kRLux = 18,
+	kQPS = 19,
+	kRPS = 20,
+	kSLedMode = 21,
+	kQLedMode = 22,
+	kRLedMode = 23,
+	kSLedModeRestore = 24,
+	kSLedFadeMinMax = 25,
+	kQLedFadeMinMax = 26,
+	kRLedFadeMinMax = 27,
+	kSLedCmdFadeTo = 28,
+	kSCalibratePS = 29,
+	kRCalibratePS = 30,
+	kSReset = 31,
+	kQProfile = 32,
+	kRProfile = 33,
+	kRProfileLoop = 34,
+	kSLedCmdFadeOver = 35,
+	kSLedWave = 36,
+	kRLedWave = 37,
+	kSLedScene = 38,
+	kRLedScene = 39,
+	kSLedScenePlay = 40,
+	kQStorageStats = 41,
+	kRStorageStats = 42,
+	kQSamples = 43,
+	kRSamples = 44,
+	kSPushDeadband = 45,
+	kSPushHeartbeat = 46,
+	kQPushConfig = 47,
+	kRPushConfig = 48,
+	kQSampleDump = 49,
+	kRSampleBlock = 50,
+	kRSampleDumpEnd = 51,
+	kSPsFilter = 52,
+	kQPsFilter = 53,
+	kRPsFilter = 54,
+	kQAlsVerify = 55,
+	kRAlsVerify = 56,
+	kSAlsRange = 57,
+	kQAlsRange = 58,
+	kRAlsRange = 59,
+	kQWhiteRatio = 60,
+	kRWhiteRatio = 61,
+	kQRam = 62,
+	kRRam = 63,
+	kQTrace = 64,
+	kRTrace = 65,
+	kRTraceEnd = 66
+};
+
+// CmdMessenger's separators, as the firmware sets them up
+constexpr char kFieldSeparator = ',';
+constexpr char kCommandSeparator = ';';
+constexpr char kEscapeCharacter = '/';
+
+} // namespace sensorhub
+
+#endif
@@ -0,0 +1,140 @@
+#ifndef SENSORHUB_MESSENGER_H
+#define SENSORHUB_MESSENGER_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "sensorhub/Protocol.h"
+
+// CmdMessenger over a POSIX file descriptor: a serial port from
+// openSerial(), a pty, or a pair of pipes to the native firmware build.
+//
+// A reader thread parses what arrives and hands each frame first to the
+// oldest request waiting for that command, then to the callback for it.
+// Callbacks run on the reader thread and see the frame only for the length
+// of the call; copy it into a Message to keep it. They may send, but a
+// callback that waits on a request would wait forever, since the reply
+// needs the same thread.
+//
+// The firmware pushes on the same IDs it replies with, so a push that
+// arrives first answers a request for that ID. The data is the same.
+//
+// A write to a pipe whose reader has gone raises SIGPIPE; a program that
+// talks to the native build over pipes should ignore it.
+
+namespace sensorhub {
+
+enum class RequestStatus
+{
+	Ok,
+	Timeout,
+	Closed		// the descriptor closed or failed, or the request could not be sent
+};
+
+struct Reply
+{
+	RequestStatus status = RequestStatus::Closed;
+	Message message;
+
+	Frame frame() const { return message.frame(); }
+};
+
+class Messenger
+{
+public:
+	using Callback = std::function<void(const Frame &)>;
+	using Clock = std::chrono::steady_clock;
+
+	// the descriptors stay the caller's to close, after the Messenger is gone
+	explicit Messenger(int fd) : Messenger(fd, fd) {}
+	Messenger(int readFd, int writeFd);
+	~Messenger();
+	Messenger(const Messenger &) = delete;
+	Messenger &operator=(const Messenger &) = delete;
+
+	// one callback per command ID; an empty one removes it
+	void on(uint8_t command, Callback callback);
+	// frames with no callback of their own
+	void onOther(Callback callback);
+
+	// formats and writes a whole frame; false if the write failed
+	template <class... Args>
+	bool send(uint8_t command, const Args &... args)
+	{
+		std::lock_guard<std::mutex> lock(writeMutex_);
+		out_.clear();
+		formatFrame(out_, command, args...);
+		return writeOut();
+	}
+
+	// sends command and waits, without blocking the caller, for the next
+	// frame with the reply ID. The future is always made ready: with the
+	// reply, once the timeout has passed, or when the descriptor closes.
+	template <class... Args>
+	std::future<Reply> request(uint8_t command, uint8_t reply, std::chrono::milliseconds timeout, const Args &... args)
+	{
+		uint64_t id;
+		std::future<Reply> future = expect(reply, timeout, id);
+		if (!send(command, args...)) {
+			cancel(id);
+		}
+		return future;
+	}
+
+	// false once the other end has closed or a read has failed
+	bool open() const { return open_; }
+	// frames dropped for not fitting the parser
+	uint32_t overflows() const { return overflows_; }
+
+private:
+	struct Pending
+	{
+		uint64_t id;
+		uint8_t reply;
+		Clock::time_point deadline;
+		std::promise<Reply> promise;
+	};
+
+	bool writeOut();
+	std::future<Reply> expect(uint8_t reply, std::chrono::milliseconds timeout, uint64_t &id);
+	void cancel(uint64_t id);
+	void wake();
+	void run();
+	void dispatch(const Frame &frame);
+	int pollTimeout();
+	void expire(Clock::time_point now);
+	void closeAll();
+
+	int readFd_;
+	int writeFd_;
+	int wake_[2];
+	std::atomic<bool> stop_{false};
+	std::atomic<bool> open_{true};
+	std::atomic<uint32_t> overflows_{0};
+	FrameParser parser_;						// reader thread only
+
+	std::mutex writeMutex_;
+	std::string out_;
+
+	std::mutex callbackMutex_;
+	std::array<Callback, 256> callbacks_;
+	Callback other_;
+
+	std::mutex pendingMutex_;
+	std::list<Pending> pending_;
+	uint64_t nextId_ = 0;
+
+	std::thread reader_;						// last, so it starts after the rest is set up
+};
+
+} // namespace sensorhub
+
+#endif
@@ -0,0 +1,218 @@
+#ifndef SENSORHUB_PROTOCOL_H
+#define SENSORHUB_PROTOCOL_H
+
+#include <array>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include "sensorhub/Commands.h"
+
+// The CmdMessenger wire format: a command ID and its arguments, separated
+// by kFieldSeparator and ended by kCommandSeparator. kEscapeCharacter puts
+// either separator, itself or a NUL into an argument as a plain byte. Text
+// arguments are numbers as printed by Arduino's Print; binary arguments are
+// the raw bytes of the value, little endian as on the AVR, escaped.
+
+namespace sensorhub {
+
+constexpr size_t kMaxFrameSize = 512;	// unescaped bytes, separators left out
+constexpr size_t kMaxArgs = 32;
+
+// One received frame, unescaped, as a view into whatever holds it: the
+// parser's buffer until the next byte is fed, or a Message.
+class Frame
+{
+public:
+	Frame(const char *data, const uint16_t *bounds, size_t fields)
+		: data_(data), bounds_(bounds), fields_(fields) {}
+
+	// false when the first field is not a command ID
+	bool valid() const;
+	uint8_t command() const;
+	size_t args() const { return fields_ - 1; }
+	std::string_view arg(size_t i) const;
+
+	// a text argument as a number, bool or string_view; false if it is
+	// missing or does not parse whole
+	template <class T>
+	bool read(size_t i, T &value) const
+	{
+		if (i >= args()) {
+			return false;
+		}
+		return parseText(arg(i), value);
+	}
+
+	// a binary argument; false unless it is exactly sizeof(T) bytes
+	template <class T>
+	bool readBin(size_t i, T &value) const
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "binary arguments are copied bytewise");
+		if (i >= args() || arg(i).size() != sizeof(T)) {
+			return false;
+		}
+		std::memcpy(&value, arg(i).data(), sizeof(T));
+		return true;
+	}
+
+	template <class T>
+	static bool parseText(std::string_view text, T &value)
+	{
+		if constexpr (std::is_same_v<T, std::string_view>) {
+			value = text;
+			return true;
+		}
+		else if constexpr (std::is_same_v<T, bool>) {
+			long v;
+			if (!parseText(text, v)) {
+				return false;
+			}
+			value = v != 0;
+			return true;
+		}
+		else if constexpr (std::is_integral_v<T>) {
+			auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+			return result.ec == std::errc() && result.ptr == text.data() + text.size();
+		}
+		else if constexpr (std::is_floating_point_v<T>) {
+			// strtod wants a terminated string; arguments that long are not numbers
+			char buffer[64];
+			if (text.empty() || text.size() >= sizeof(buffer)) {
+				return false;
+			}
+			std::memcpy(buffer, text.data(), text.size());
+			buffer[text.size()] = '\0';
+			char *end;
+			value = T(std::strtod(buffer, &end));
+			return end == buffer + text.size();
+		}
+		else {
+			static_assert(!sizeof(T), "no text format for this type");
+		}
+	}
+
+private:
+	friend class Message;
+
+	const char *data_;
+	const uint16_t *bounds_;	// field i is data_[bounds_[i], bounds_[i + 1])
+	size_t fields_;
+};
+
+// Incremental parser. Bytes go in one at a time and are unescaped into a
+// fixed buffer; nothing is allocated. Line ends between frames, which the
+// firmware sends after each one, are skipped. A frame that does not fit is
+// dropped whole.
+class FrameParser
+{
+public:
+	// true when c completes a frame, which frame() then shows
+	bool feed(char c);
+	Frame frame() const { return Frame(buffer_.data(), bounds_.data(), fields_); }
+	uint32_t overflows() const { return overflows_; }
+
+private:
+	void reset();
+	void put(char c);
+
+	std::array<char, kMaxFrameSize> buffer_{};
+	std::array<uint16_t, kMaxArgs + 2> bounds_{};
+	size_t length_ = 0;
+	size_t fields_ = 1;
+	bool started_ = false;
+	bool escaped_ = false;
+	bool overflow_ = false;
+	bool done_ = true;
+	uint32_t overflows_ = 0;
+};
+
+// A frame that keeps its own copy, for handing on past the next byte.
+class Message
+{
+public:
+	Message() = default;
+	explicit Message(const Frame &frame);
+
+	Frame frame() const { return Frame(data_.data(), bounds_.data(), fields_); }
+
+private:
+	std::string data_;
+	std::array<uint16_t, kMaxArgs + 2> bounds_{};
+	size_t fields_ = 1;
+};
+
+// Wraps a value to be sent as a binary argument.
+template <class T>
+struct Binary
+{
+	const T &value;
+};
+
+template <class T>
+Binary<T> binary(const T &value)
+{
+	static_assert(std::is_trivially_copyable_v<T>, "binary arguments are copied bytewise");
+	return Binary<T>{value};
+}
+
+void appendEscaped(std::string &out, const char *data, size_t size);
+
+// Appends one argument, separator first. The format is picked from the
+// type at compile time, and a type with no wire format does not compile.
+template <class T>
+void appendArg(std::string &out, const T &value)
+{
+	out += kFieldSeparator;
+	if constexpr (std::is_same_v<T, bool>) {
+		out += value ? '1' : '0';
+	}
+	else if constexpr (std::is_same_v<T, char>) {
+		appendEscaped(out, &value, 1);
+	}
+	else if constexpr (std::is_integral_v<T> || std::is_enum_v<T>) {
+		// to_chars would print an enum or a uint8_t as a character
+		char buffer[24];
+		auto result = std::to_chars(buffer, buffer + sizeof(buffer), +static_cast<std::conditional_t<std::is_enum_v<T>, int, T>>(value));
+		out.append(buffer, result.ptr);
+	}
+	else if constexpr (std::is_floating_point_v<T>) {
+		char buffer[32];
+		auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+		out.append(buffer, result.ptr);
+	}
+	else if constexpr (std::is_convertible_v<const T &, std::string_view>) {
+		std::string_view text(value);
+		appendEscaped(out, text.data(), text.size());
+	}
+	else {
+		static_assert(!sizeof(T), "no wire format for this type");
+	}
+}
+
+template <class T>
+void appendArg(std::string &out, const Binary<T> &arg)
+{
+	out += kFieldSeparator;
+	appendEscaped(out, reinterpret_cast<const char *>(&arg.value), sizeof(T));
+}
+
+// a whole frame: the command ID, each argument, the command separator
+template <class... Args>
+void formatFrame(std::string &out, uint8_t command, const Args &... args)
+{
+	char buffer[4];
+	auto result = std::to_chars(buffer, buffer + sizeof(buffer), unsigned(command));
+	out.append(buffer, result.ptr);
+	(appendArg(out, args), ...);
+	out += kCommandSeparator;
+}
+
+} // namespace sensorhub
+
+#endif
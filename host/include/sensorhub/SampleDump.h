@@ -0,0 +1,87 @@
+#ifndef SENSORHUB_SAMPLEDUMP_H
+#define SENSORHUB_SAMPLEDUMP_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Decoder for the blocks the firmware sends in reply to kQSampleDump, see
+// firmware/src/SampleDump.h for the encoder. Blocks are passed in as the
+// unescaped bytes of the kRSampleBlock binary argument.
+
+namespace sensorhub {
+
+constexpr uint8_t kSampleDumpFormat = 1;
+constexpr size_t kSampleChannels = 5;
+
+enum SampleChannel : uint8_t
+{
+	kChannelTemperature = 0,
+	kChannelHumidity = 1,
+	kChannelPressure = 2,	// Pa above kSamplePressureOffset
+	kChannelLux = 3,
+	kChannelPs = 4
+};
+
+constexpr uint32_t kSamplePressureOffset = 50000;
+
+struct Sample
+{
+	uint32_t seq;
+	uint16_t time;			// seconds since node boot, wraps every 18 hours
+	std::array<uint16_t, kSampleChannels> value;
+
+	uint32_t pressurePa() const { return value[kChannelPressure] + kSamplePressureOffset; }
+};
+
+enum class DumpError
+{
+	None,
+	Truncated,		// ran out of bytes before the end of the block
+	BadCrc,
+	BadFormat,		// unknown format or channel count
+	TrailingBytes
+};
+
+struct SampleBlock
+{
+	uint32_t firstSeq = 0;
+	std::vector<Sample> samples;
+};
+
+// CRC-16 as avr-libc's _crc16_update, polynomial 0xA001 reflected
+uint16_t crc16(const uint8_t *data, size_t size, uint16_t crc = 0xFFFF);
+
+DumpError decodeSampleBlock(const uint8_t *data, size_t size, SampleBlock &block);
+inline DumpError decodeSampleBlock(const std::vector<uint8_t> &data, SampleBlock &block)
+{
+	return decodeSampleBlock(data.data(), data.size(), block);
+}
+
+// Keeps track of where to resume a dump, and of samples lost in between
+// because they left the ring before they were fetched.
+class SampleDumpCursor
+{
+public:
+	explicit SampleDumpCursor(uint32_t next = 0) : next_(next) {}
+
+	// the sequence number to pass to kQSampleDump
+	uint32_t next() const { return next_; }
+	uint32_t missed() const { return missed_; }
+
+	// accepts a decoded block, returns false if it is entirely older than next()
+	bool accept(const SampleBlock &block);
+
+	// handles the kRSampleDumpEnd arguments; returns true if the node has
+	// restarted since the cursor was last used, in which case it starts over
+	bool end(uint32_t next, uint32_t oldest, uint32_t total);
+
+private:
+	uint32_t next_;
+	uint32_t missed_ = 0;
+};
+
+} // namespace sensorhub
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef SENSORHUB_SERIALPORT_H
+#define SENSORHUB_SERIALPORT_H
+
+namespace sensorhub {
+
+// The firmware's Serial.begin() rate
+constexpr unsigned kSerialBaud = 38400;
+
+// Opens a serial port raw, 8N1 at baud, for a Messenger. A pty is set up
+// the same way, and a path that is not a terminal is opened as it is.
+// Returns the descriptor, or -1 with errno set; an unsupported baud rate
+// gives EINVAL.
+int openSerial(const char *path, unsigned baud = kSerialBaud);
+
+} // namespace sensorhub
+
+#endif
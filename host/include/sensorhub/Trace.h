@@ -0,0 +1,60 @@
+#ifndef SENSORHUB_TRACE_H
+#define SENSORHUB_TRACE_H
+
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <vector>
+
+#include "sensorhub/Commands.h"
+
+// Reader for the serial trace a SYS_TRACE build sends in reply to kQTrace,
+// see firmware/src/Trace.h. Each kRTrace carries one frame as it went over
+// the wire, command separator included; kRTraceEnd closes a dump.
+
+namespace sensorhub {
+
+struct TraceFrame
+{
+	uint32_t time = 0;			// node millis() at the first byte
+	bool out = false;				// sent by the node
+	bool truncated = false;	// only the start of the frame was kept
+	std::string data;
+
+	// a truncated frame matches any frame it is the start of
+	bool matches(const std::string &frame) const;
+};
+
+struct Trace
+{
+	std::vector<TraceFrame> frames;
+	uint32_t dropped = 0;		// frames the node lost to a full ring
+	size_t dumps = 0;
+};
+
+// true for the kQTrace that asked for a dump; the replies to it are never
+// in the trace
+bool isTraceQuery(const TraceFrame &frame);
+
+// Cuts a byte stream into frames at unescaped command separators. Line ends
+// between frames are left out, the same as the firmware does for the trace.
+class FrameSplitter
+{
+public:
+	// true when c completes a frame, which frame() then holds
+	bool feed(char c);
+	const std::string &frame() const { return frame_; }
+
+private:
+	std::string frame_;
+	bool done_ = false;
+	bool escaped_ = false;
+};
+
+// collects every kRTrace and kRTraceEnd in a capture, skipping anything
+// else; returns false if there was no trace in it
+bool readTrace(std::istream &in, Trace &trace);
+
+} // namespace sensorhub
+
+#endif
@@ -0,0 +1,221 @@
+#include "sensorhub/Messenger.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+namespace sensorhub {
+
+Messenger::Messenger(int readFd, int writeFd)
+	: readFd_(readFd), writeFd_(writeFd)
+{
+	if (pipe(wake_) != 0) {
+		wake_[0] = wake_[1] = -1;
+	}
+	else {
+		fcntl(wake_[0], F_SETFL, O_NONBLOCK);
+		fcntl(wake_[1], F_SETFL, O_NONBLOCK);
+	}
+	reader_ = std::thread(&Messenger::run, this);
+}
+
+Messenger::~Messenger()
+{
+	stop_ = true;
+	wake();
+	reader_.join();
+	if (wake_[0] >= 0)
+	{
+		close(wake_[0]);
+		close(wake_[1]);
+	}
+}
+
+void Messenger::on(uint8_t command, Callback callback)
+{
+	std::lock_guard<std::mutex> lock(callbackMutex_);
+	callbacks_[command] = std::move(callback);
+}
+
+void Messenger::onOther(Callback callback)
+{
+	std::lock_guard<std::mutex> lock(callbackMutex_);
+	other_ = std::move(callback);
+}
+
+bool Messenger::writeOut()
+{
+	const char *p = out_.data();
+	size_t left = out_.size();
+	while (left > 0)
+	{
+		ssize_t n = write(writeFd_, p, left);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			return false;
+		}
+		p += n;
+		left -= size_t(n);
+	}
+	return true;
+}
+
+std::future<Reply> Messenger::expect(uint8_t reply, std::chrono::milliseconds timeout, uint64_t &id)
+{
+	std::future<Reply> future;
+	{
+		std::lock_guard<std::mutex> lock(pendingMutex_);
+		id = nextId_++;
+		pending_.push_back({id, reply, Clock::now() + timeout, std::promise<Reply>()});
+		future = pending_.back().promise.get_future();
+	}
+	if (!open_) {
+		cancel(id);
+	}
+	// the reader has to pick up the new deadline
+	wake();
+	return future;
+}
+
+void Messenger::cancel(uint64_t id)
+{
+	std::unique_lock<std::mutex> lock(pendingMutex_);
+	auto it = std::find_if(pending_.begin(), pending_.end(), [id](const Pending &p) { return p.id == id; });
+	if (it == pending_.end()) {
+		return;
+	}
+	std::promise<Reply> promise = std::move(it->promise);
+	pending_.erase(it);
+	lock.unlock();
+	promise.set_value(Reply());
+}
+
+void Messenger::wake()
+{
+	if (wake_[1] >= 0)
+	{
+		char c = 0;
+		(void)!write(wake_[1], &c, 1);
+	}
+}
+
+void Messenger::dispatch(const Frame &frame)
+{
+	uint8_t command = frame.command();
+	{
+		std::unique_lock<std::mutex> lock(pendingMutex_);
+		auto it = std::find_if(pending_.begin(), pending_.end(), [command](const Pending &p) { return p.reply == command; });
+		if (it != pending_.end())
+		{
+			std::promise<Reply> promise = std::move(it->promise);
+			pending_.erase(it);
+			lock.unlock();
+			Reply reply;
+			reply.status = RequestStatus::Ok;
+			reply.message = Message(frame);
+			promise.set_value(std::move(reply));
+		}
+	}
+	// called outside the lock so a callback can change the registry
+	Callback callback;
+	{
+		std::lock_guard<std::mutex> lock(callbackMutex_);
+		callback = callbacks_[command] ? callbacks_[command] : other_;
+	}
+	if (callback) {
+		callback(frame);
+	}
+}
+
+// ms to the nearest deadline, -1 with nothing pending
+int Messenger::pollTimeout()
+{
+	std::lock_guard<std::mutex> lock(pendingMutex_);
+	if (pending_.empty()) {
+		return -1;
+	}
+	auto nearest = std::min_element(pending_.begin(), pending_.end(),
+		[](const Pending &a, const Pending &b) { return a.deadline < b.deadline; })->deadline;
+	auto ms = std::chrono::ceil<std::chrono::milliseconds>(nearest - Clock::now()).count();
+	return int(std::max<decltype(ms)>(ms, 0));
+}
+
+void Messenger::expire(Clock::time_point now)
+{
+	std::list<Pending> expired;
+	{
+		std::lock_guard<std::mutex> lock(pendingMutex_);
+		for (auto it = pending_.begin(); it != pending_.end();)
+		{
+			auto next = std::next(it);
+			if (it->deadline <= now) {
+				expired.splice(expired.end(), pending_, it);
+			}
+			it = next;
+		}
+	}
+	for (Pending &p : expired)
+	{
+		Reply reply;
+		reply.status = RequestStatus::Timeout;
+		p.promise.set_value(std::move(reply));
+	}
+}
+
+void Messenger::closeAll()
+{
+	std::list<Pending> closed;
+	{
+		std::lock_guard<std::mutex> lock(pendingMutex_);
+		open_ = false;
+		closed.swap(pending_);
+	}
+	for (Pending &p : closed) {
+		p.promise.set_value(Reply());
+	}
+}
+
+void Messenger::run()
+{
+	char buffer[256];
+	while (!stop_)
+	{
+		pollfd fds[2] = {{readFd_, POLLIN, 0}, {wake_[0], POLLIN, 0}};
+		int n = poll(fds, wake_[0] >= 0 ? 2 : 1, pollTimeout());
+		if (n < 0 && errno != EINTR) {
+			break;
+		}
+		if (n > 0 && (fds[1].revents & POLLIN))
+		{
+			while (read(wake_[0], buffer, sizeof(buffer)) > 0) {
+			}
+		}
+		if (n > 0 && fds[0].revents)
+		{
+			ssize_t got = read(readFd_, buffer, sizeof(buffer));
+			if (got == 0 || (got < 0 && errno != EINTR && errno != EAGAIN)) {
+				break;
+			}
+			for (ssize_t i = 0; i < got; i++)
+			{
+				if (!parser_.feed(buffer[i])) {
+					continue;
+				}
+				Frame frame = parser_.frame();
+				if (frame.valid()) {
+					dispatch(frame);
+				}
+			}
+			overflows_ = parser_.overflows();
+		}
+		expire(Clock::now());
+	}
+	closeAll();
+}
+
+} // namespace sensorhub
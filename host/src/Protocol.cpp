@@ -0,0 +1,113 @@
+#include "sensorhub/Protocol.h"
+
+namespace sensorhub {
+
+bool Frame::valid() const
+{
+	uint8_t id;
+	return fields_ > 0 && parseText(std::string_view(data_ + bounds_[0], bounds_[1] - bounds_[0]), id);
+}
+
+uint8_t Frame::command() const
+{
+	uint8_t id = 0;
+	parseText(std::string_view(data_ + bounds_[0], bounds_[1] - bounds_[0]), id);
+	return id;
+}
+
+std::string_view Frame::arg(size_t i) const
+{
+	if (i >= args()) {
+		return std::string_view();
+	}
+	return std::string_view(data_ + bounds_[i + 1], bounds_[i + 2] - bounds_[i + 1]);
+}
+
+void FrameParser::reset()
+{
+	length_ = 0;
+	fields_ = 1;
+	bounds_[0] = 0;
+	started_ = false;
+	escaped_ = false;
+	overflow_ = false;
+	done_ = false;
+}
+
+void FrameParser::put(char c)
+{
+	if (length_ < buffer_.size()) {
+		buffer_[length_++] = c;
+	}
+	else {
+		overflow_ = true;
+	}
+}
+
+bool FrameParser::feed(char c)
+{
+	if (done_) {
+		reset();
+	}
+	if (!started_)
+	{
+		if (c == '\r' || c == '\n') {
+			return false;
+		}
+		started_ = true;
+	}
+	if (escaped_)
+	{
+		escaped_ = false;
+		put(c);
+		return false;
+	}
+	if (c == kEscapeCharacter) {
+		escaped_ = true;
+	}
+	else if (c == kFieldSeparator)
+	{
+		if (fields_ + 1 < bounds_.size()) {
+			bounds_[fields_++] = uint16_t(length_);
+		}
+		else {
+			overflow_ = true;
+		}
+	}
+	else if (c == kCommandSeparator)
+	{
+		bounds_[fields_] = uint16_t(length_);
+		done_ = true;
+		if (overflow_) {
+			overflows_++;
+			return false;
+		}
+		return true;
+	}
+	else {
+		put(c);
+	}
+	return false;
+}
+
+Message::Message(const Frame &frame)
+	: data_(frame.data_, frame.bounds_[frame.fields_]), fields_(frame.fields_)
+{
+	for (size_t i = 0; i <= fields_; i++) {
+		bounds_[i] = frame.bounds_[i];
+	}
+}
+
+void appendEscaped(std::string &out, const char *data, size_t size)
+{
+	for (size_t i = 0; i < size; i++)
+	{
+		char c = data[i];
+		if (c == kFieldSeparator || c == kCommandSeparator || c == kEscapeCharacter || c == '\0') {
+			out += kEscapeCharacter;
+		}
+		out += c;
+	}
+}
+
+} // namespace sensorhub
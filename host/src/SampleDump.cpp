@@ -0,0 +1,115 @@
+#include "sensorhub/SampleDump.h"
+
+namespace sensorhub {
+
+namespace {
+
+constexpr size_t kHeaderSize = 7;
+constexpr size_t kCrcSize = 2;
+
+bool readVarint(const uint8_t *&p, const uint8_t *end, uint16_t &value)
+{
+	uint32_t v = 0;
+	for (unsigned shift = 0; shift < 21; shift += 7)
+	{
+		if (p == end) {
+			return false;
+		}
+		uint8_t byte = *p++;
+		v |= uint32_t(byte & 0x7F) << shift;
+		if (!(byte & 0x80)) {
+			value = uint16_t(v);
+			return true;
+		}
+	}
+	return false;
+}
+
+uint16_t unZigZag(uint16_t from, uint16_t code)
+{
+	int16_t delta = int16_t((code >> 1) ^ -(code & 1));
+	return uint16_t(from + delta);
+}
+
+} // namespace
+
+uint16_t crc16(const uint8_t *data, size_t size, uint16_t crc)
+{
+	for (size_t i = 0; i < size; i++)
+	{
+		crc ^= data[i];
+		for (int bit = 0; bit < 8; bit++) {
+			crc = (crc & 1) ? (crc >> 1) ^ 0xA001 : (crc >> 1);
+		}
+	}
+	return crc;
+}
+
+DumpError decodeSampleBlock(const uint8_t *data, size_t size, SampleBlock &block)
+{
+	block.samples.clear();
+	if (size < kHeaderSize + kCrcSize) {
+		return DumpError::Truncated;
+	}
+	uint16_t crc = uint16_t(data[size - 2] | (data[size - 1] << 8));
+	if (crc16(data, size - kCrcSize) != crc) {
+		return DumpError::BadCrc;
+	}
+	if (data[0] != kSampleDumpFormat || data[1] != kSampleChannels) {
+		return DumpError::BadFormat;
+	}
+	uint8_t count = data[2];
+	block.firstSeq = uint32_t(data[3]) | uint32_t(data[4]) << 8 | uint32_t(data[5]) << 16 | uint32_t(data[6]) << 24;
+
+	const uint8_t *p = data + kHeaderSize;
+	const uint8_t *end = data + size - kCrcSize;
+	Sample prev{};
+	for (uint8_t i = 0; i < count; i++)
+	{
+		Sample sample{};
+		sample.seq = block.firstSeq + i;
+		uint16_t code;
+		if (!readVarint(p, end, code)) {
+			return DumpError::Truncated;
+		}
+		sample.time = unZigZag(prev.time, code);
+		for (size_t c = 0; c < kSampleChannels; c++)
+		{
+			if (!readVarint(p, end, code)) {
+				return DumpError::Truncated;
+			}
+			sample.value[c] = unZigZag(prev.value[c], code);
+		}
+		block.samples.push_back(sample);
+		prev = sample;
+	}
+	return (p == end) ? DumpError::None : DumpError::TrailingBytes;
+}
+
+bool SampleDumpCursor::accept(const SampleBlock &block)
+{
+	uint32_t after = block.firstSeq + uint32_t(block.samples.size());
+	if (int32_t(after - next_) <= 0) {
+		return false;
+	}
+	if (int32_t(block.firstSeq - next_) > 0) {
+		missed_ += block.firstSeq - next_;
+	}
+	next_ = after;
+	return true;
+}
+
+bool SampleDumpCursor::end(uint32_t next, uint32_t oldest, uint32_t total)
+{
+	(void)oldest;
+	if (int32_t(total - next_) < 0)
+	{
+		// the node counts from 0 again after a restart
+		next_ = 0;
+		return true;
+	}
+	next_ = next;
+	return false;
+}
+
+} // namespace sensorhub
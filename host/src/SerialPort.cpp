@@ -0,0 +1,61 @@
+#include "sensorhub/SerialPort.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace sensorhub {
+
+namespace {
+
+bool baudConstant(unsigned baud, speed_t &speed)
+{
+	switch (baud)
+	{
+		case 9600: speed = B9600; return true;
+		case 19200: speed = B19200; return true;
+		case 38400: speed = B38400; return true;
+		case 57600: speed = B57600; return true;
+		case 115200: speed = B115200; return true;
+		default: return false;
+	}
+}
+
+} // namespace
+
+int openSerial(const char *path, unsigned baud)
+{
+	speed_t speed;
+	if (!baudConstant(baud, speed)) {
+		errno = EINVAL;
+		return -1;
+	}
+	int fd = open(path, O_RDWR | O_NOCTTY | O_CLOEXEC);
+	if (fd < 0 || !isatty(fd)) {
+		return fd;
+	}
+	termios tio;
+	if (tcgetattr(fd, &tio) != 0) {
+		int error = errno;
+		close(fd);
+		errno = error;
+		return -1;
+	}
+	cfmakeraw(&tio);
+	tio.c_cflag |= CLOCAL | CREAD;
+	tio.c_cflag &= ~(CSTOPB | CRTSCTS);
+	tio.c_cc[VMIN] = 1;
+	tio.c_cc[VTIME] = 0;
+	cfsetispeed(&tio, speed);
+	cfsetospeed(&tio, speed);
+	if (tcsetattr(fd, TCSANOW, &tio) != 0) {
+		int error = errno;
+		close(fd);
+		errno = error;
+		return -1;
+	}
+	return fd;
+}
+
+} // namespace sensorhub
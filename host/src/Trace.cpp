@@ -0,0 +1,88 @@
+#include "sensorhub/Trace.h"
+
+#include "sensorhub/Protocol.h"
+
+namespace sensorhub {
+
+bool TraceFrame::matches(const std::string &frame) const
+{
+	if (truncated) {
+		return frame.compare(0, data.size(), data) == 0;
+	}
+	return frame == data;
+}
+
+bool isTraceQuery(const TraceFrame &frame)
+{
+	FrameParser parser;
+	for (char c : frame.data)
+	{
+		if (parser.feed(c)) {
+			return !frame.out && parser.frame().valid() && parser.frame().command() == kQTrace;
+		}
+	}
+	return false;
+}
+
+bool FrameSplitter::feed(char c)
+{
+	if (done_)
+	{
+		frame_.clear();
+		done_ = false;
+	}
+	if (frame_.empty() && (c == '\r' || c == '\n')) {
+		return false;
+	}
+	frame_ += c;
+	if (escaped_) {
+		escaped_ = false;
+		return false;
+	}
+	if (c == kEscapeCharacter) {
+		escaped_ = true;
+		return false;
+	}
+	done_ = (c == kCommandSeparator);
+	return done_;
+}
+
+bool readTrace(std::istream &in, Trace &trace)
+{
+	FrameParser parser;
+	bool found = false;
+	char c;
+	while (in.get(c))
+	{
+		if (!parser.feed(c)) {
+			continue;
+		}
+		Frame frame = parser.frame();
+		if (!frame.valid()) {
+			continue;
+		}
+		if (frame.command() == kRTrace && frame.args() == 4)
+		{
+			TraceFrame traced;
+			std::string_view data;
+			if (!frame.read(0, traced.time) || !frame.read(1, traced.out) || !frame.read(2, traced.truncated) || !frame.read(3, data)) {
+				continue;
+			}
+			traced.data = std::string(data);
+			trace.frames.push_back(traced);
+			found = true;
+		}
+		else if (frame.command() == kRTraceEnd)
+		{
+			uint32_t dropped;
+			if (frame.read(0, dropped)) {
+				trace.dropped += dropped;
+			}
+			trace.dumps++;
+			found = true;
+		}
+	}
+	return found;
+}
+
+} // namespace sensorhub
@@ -0,0 +1,48 @@
+#ifndef SENSORHUB_TESTS_CHECK_H
+#define SENSORHUB_TESTS_CHECK_H
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+// Just enough of a harness for ctest. A failed CHECK prints where it was
+// and the test carries on; main returns checkResult(), which is 1 if
+// anything failed. Captures of the firmware's output are in tests/data.
+
+namespace check {
+
+inline int &failures()
+{
+	static int count = 0;
+	return count;
+}
+
+inline void fail(const char *file, int line, const char *condition)
+{
+	std::fprintf(stderr, "%s:%d: failed: %s\n", file, line, condition);
+	failures()++;
+}
+
+// the whole of a file in tests/data, empty if it is missing
+inline std::string readData(const char *name)
+{
+	std::ifstream in(std::string(SENSORHUB_TEST_DATA) + "/" + name, std::ios::binary);
+	std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+	if (data.empty()) {
+		std::fprintf(stderr, "no test data in %s/%s\n", SENSORHUB_TEST_DATA, name);
+		failures()++;
+	}
+	return data;
+}
+
+} // namespace check
+
+#define CHECK(condition) ((condition) ? (void)0 : check::fail(__FILE__, __LINE__, #condition))
+
+inline int checkResult()
+{
+	return check::failures() ? 1 : 0;
+}
+
+#endif
@@ -0,0 +1,122 @@
+// The firmware's fade engine, firmware/src/LEDFade.h, driven the way the
+// task loop drives it: ledFadeStart() once, then ledFadeLevel() and
+// ledFadeDone() against the clock, over every curve.
+
+#include <cstdint>
+
+#include "Check.h"
+
+// the firmware's LED and fade code, in the global namespace
+#include "LEDFade.h"
+
+namespace {
+
+const uint8_t curves[] = {LED_CURVE_LINEAR, LED_CURVE_EASE_IN, LED_CURVE_EASE_OUT, LED_CURVE_EASE_IN_OUT, LED_CURVE_EXPONENTIAL};
+
+// how far a curve may step back: smoothstep truncates two terms apart
+int slack(uint8_t curve)
+{
+	return (curve == LED_CURVE_EASE_IN_OUT) ? 2 : 0;
+}
+
+// each curve starts at 0, ends at full scale and never turns back
+void testCurves()
+{
+	for (uint8_t curve : curves)
+	{
+		CHECK(ledCurve(curve, 0) == 0);
+		CHECK(ledCurve(curve, 65535) >= 65500);
+		unsigned backwards = 0;
+		for (uint32_t p = 1; p < 0x10000; p++) {
+			backwards += ledCurve(curve, uint16_t(p)) + slack(curve) < ledCurve(curve, uint16_t(p - 1));
+		}
+		CHECK(backwards == 0);
+	}
+	CHECK(ledCurve(LED_CURVE_EASE_IN, 65535) == 65535 && ledCurve(LED_CURVE_EASE_OUT, 65535) == 65535);
+	// halfway along each one
+	CHECK(ledCurve(LED_CURVE_LINEAR, 32768) == 32768);
+	CHECK(ledCurve(LED_CURVE_EASE_IN, 32768) == 16384);
+	CHECK(ledCurve(LED_CURVE_EASE_OUT, 32768) >= 49150 && ledCurve(LED_CURVE_EASE_OUT, 32768) <= 49152);
+	CHECK(ledCurve(LED_CURVE_EASE_IN_OUT, 32768) == 32768);
+	// 2^5 - 1 of 1023
+	CHECK(ledCurve(LED_CURVE_EXPONENTIAL, 32768) >= 1980 && ledCurve(LED_CURVE_EXPONENTIAL, 32768) <= 1990);
+	// an unknown curve is linear
+	CHECK(ledCurve(99, 12345) == 12345);
+}
+
+// a fade a millisecond at a time: from its start level, one way only (but
+// for smoothstep's last bit), done and at its target exactly when its time
+// is up
+void testFade(uint16_t from, uint16_t to, uint16_t duration, uint8_t curve, uint32_t start)
+{
+	LedFade fade;
+	ledFadeStart(fade, from, to, duration, curve, start);
+	CHECK(ledFadeLevel(fade, start) == from);
+	uint16_t last = from;
+	unsigned backwards = 0;
+	for (uint32_t t = 0; t < duration; t++)
+	{
+		uint16_t level = ledFadeLevel(fade, start + t);
+		int step = (to >= from) ? level - last : last - level;
+		backwards += step < -(slack(curve) / 2);
+		CHECK(!ledFadeDone(fade, start + t));
+		last = level;
+	}
+	CHECK(backwards == 0);
+	CHECK(ledFadeDone(fade, start + duration));
+	CHECK(ledFadeLevel(fade, start + duration) == to);
+	CHECK(ledFadeLevel(fade, start + duration + 60000) == to);
+}
+
+void testFades()
+{
+	for (uint8_t curve : curves)
+	{
+		testFade(0, LED_LEVEL_MAX, 400, curve, 1000);
+		testFade(LED_LEVEL_MAX, 0, 400, curve, 1000);
+		testFade(LED_LEVEL(10), LED_LEVEL(80), 65535, curve, 0);
+		// across the millis() wrap, about 50 days up
+		testFade(LED_LEVEL(60), LED_LEVEL(20), 1000, curve, 0xFFFFFF00UL);
+	}
+
+	// the task loop's default speed, LED_FADE_STEP_MS a percent: halfway
+	// through a linear fade from 20 to 60 % is 40 %
+	LedFade fade;
+	ledFadeStart(fade, LED_LEVEL(20), LED_LEVEL(60), 40 * 4, LED_CURVE_LINEAR, 0);
+	CHECK(ledFadeLevel(fade, 80) == LED_LEVEL(40));
+
+	// no time at all goes straight to the target
+	ledFadeStart(fade, LED_LEVEL(20), LED_LEVEL(60), 0, LED_CURVE_EASE_IN, 500);
+	CHECK(ledFadeDone(fade, 500) && ledFadeLevel(fade, 500) == LED_LEVEL(60));
+
+	// a target past 100 % stops at 100 %
+	ledFadeStart(fade, 0, LED_LEVEL(150), 100, LED_CURVE_LINEAR, 0);
+	CHECK(ledFadeLevel(fade, 100) == LED_LEVEL_MAX);
+}
+
+// the PWM duty for every level: from the table's first entry to full on,
+// never down
+void testDuty()
+{
+	CHECK(ledCieDuty16(0) == 0);
+	CHECK(ledCieDuty16(LED_LEVEL_MAX) == 0xFFFF);
+	CHECK(ledCieDuty16(LED_LEVEL_MAX + 1) == 0xFFFF);
+	unsigned backwards = 0;
+	for (uint16_t level = 1; level <= LED_LEVEL_MAX; level++) {
+		backwards += ledCieDuty16(level) < ledCieDuty16(level - 1);
+	}
+	CHECK(backwards == 0);
+	// 50 % lightness is 18.4 % luminance
+	uint16_t half = ledCieDuty16(LED_LEVEL(50));
+	CHECK(half > 12000 && half < 12200);
+}
+
+} // namespace
+
+int main()
+{
+	testCurves();
+	testFades();
+	testDuty();
+	return checkResult();
+}
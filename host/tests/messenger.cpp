@@ -0,0 +1,191 @@
+// Messenger over a pair of pipes, with the test playing the node: replies
+// that arrive in pieces, pushes, timeouts and the node going away.
+
+#include <signal.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <future>
+#include <string>
+#include <thread>
+
+#include "Check.h"
+#include "sensorhub/Messenger.h"
+
+using namespace sensorhub;
+using namespace std::chrono_literals;
+
+namespace {
+
+// the hub reads toHub[0] and writes fromHub[1]; the node has the other ends
+struct Link
+{
+	int toHub[2] = {-1, -1};
+	int fromHub[2] = {-1, -1};
+
+	Link()
+	{
+		CHECK(pipe(toHub) == 0 && pipe(fromHub) == 0);
+	}
+	~Link()
+	{
+		for (int fd : {toHub[0], toHub[1], fromHub[0], fromHub[1]})
+		{
+			if (fd >= 0) {
+				close(fd);
+			}
+		}
+	}
+
+	void nodeSend(const std::string &bytes)
+	{
+		CHECK(write(toHub[1], bytes.data(), bytes.size()) == ssize_t(bytes.size()));
+	}
+	std::string nodeReceive(size_t size)
+	{
+		std::string bytes(size, '\0');
+		size_t got = 0;
+		while (got < size)
+		{
+			ssize_t n = read(fromHub[0], &bytes[got], size - got);
+			if (n <= 0) {
+				break;
+			}
+			got += size_t(n);
+		}
+		bytes.resize(got);
+		return bytes;
+	}
+	void nodeClose()
+	{
+		close(toHub[1]);
+		toHub[1] = -1;
+	}
+};
+
+// the first sample block in dump.bin, as the firmware sent it
+std::string firstBlockFrame()
+{
+	std::string capture = check::readData("dump.bin");
+	size_t start = capture.find("\n50,");
+	if (start == std::string::npos) {
+		return std::string();
+	}
+	start++;
+	FrameParser parser;
+	for (size_t i = start; i < capture.size(); i++)
+	{
+		if (parser.feed(capture[i])) {
+			return capture.substr(start, i + 1 - start);
+		}
+	}
+	return std::string();
+}
+
+// a reply with escaped bytes, cut in the middle of an escape
+void testRequest()
+{
+	std::string block = firstBlockFrame();
+	CHECK(block.size() > 20);
+	size_t cut = block.find('/') + 1;
+
+	Link link;
+	Messenger hub(link.toHub[0], link.fromHub[1]);
+	std::future<Reply> future = hub.request(kQSampleDump, kRSampleBlock, 2s, 0, 1);
+	CHECK(link.nodeReceive(7) == "49,0,1;");
+	link.nodeSend("\r\n" + block.substr(0, cut));
+	CHECK(future.wait_for(50ms) == std::future_status::timeout);
+	link.nodeSend(block.substr(cut) + "\r\n");
+	CHECK(future.wait_for(2s) == std::future_status::ready);
+
+	Reply reply = future.get();
+	CHECK(reply.status == RequestStatus::Ok);
+	FrameParser parser;
+	for (char c : block) {
+		parser.feed(c);
+	}
+	Frame expected = parser.frame();
+	Frame frame = reply.frame();
+	CHECK(frame.command() == kRSampleBlock);
+	CHECK(frame.args() == 1 && frame.arg(0) == expected.arg(0));
+	CHECK(hub.overflows() == 0);
+}
+
+// pushes go to the callback for their command, the rest to onOther
+void testCallbacks()
+{
+	Link link;
+	Messenger hub(link.toHub[0], link.fromHub[1]);
+	std::promise<int> temp;
+	std::promise<uint8_t> other;
+	hub.on(kRTemp, [&temp](const Frame &frame) {
+		int value = 0;
+		frame.read(0, value);
+		temp.set_value(value);
+	});
+	hub.onOther([&other](const Frame &frame) { other.set_value(frame.command()); });
+	std::future<int> tempDone = temp.get_future();
+	std::future<uint8_t> otherDone = other.get_future();
+
+	link.nodeSend("12,210;\r\n14,45;\r\n");
+	CHECK(tempDone.wait_for(2s) == std::future_status::ready && tempDone.get() == 210);
+	CHECK(otherDone.wait_for(2s) == std::future_status::ready && otherDone.get() == kRHumi);
+}
+
+// every future is made ready once its own timeout has passed, a short one
+// asked for after a long one included
+void testTimeout()
+{
+	Link link;
+	Messenger hub(link.toHub[0], link.fromHub[1]);
+	auto started = Messenger::Clock::now();
+	std::future<Reply> slow = hub.request(kQTemp, kRTemp, 400ms);
+	std::future<Reply> fast = hub.request(kQLux, kRLux, 40ms);
+
+	CHECK(fast.wait_for(2s) == std::future_status::ready);
+	auto fastTook = Messenger::Clock::now() - started;
+	CHECK(slow.wait_for(0ms) == std::future_status::timeout);
+	CHECK(slow.wait_for(2s) == std::future_status::ready);
+	auto slowTook = Messenger::Clock::now() - started;
+
+	CHECK(fast.get().status == RequestStatus::Timeout);
+	CHECK(slow.get().status == RequestStatus::Timeout);
+	CHECK(fastTook >= 40ms && fastTook < 400ms);
+	CHECK(slowTook >= 400ms);
+
+	// a reply after its request has timed out goes to the callback instead
+	std::promise<void> late;
+	hub.on(kRTemp, [&late](const Frame &) { late.set_value(); });
+	std::future<void> lateDone = late.get_future();
+	link.nodeSend("12,210;\r\n");
+	CHECK(lateDone.wait_for(2s) == std::future_status::ready);
+}
+
+// a node that goes away closes whatever is waiting, and what is asked later
+void testClosed()
+{
+	Link link;
+	Messenger hub(link.toHub[0], link.fromHub[1]);
+	std::future<Reply> waiting = hub.request(kQTemp, kRTemp, 10s);
+	link.nodeSend("12,2");
+	link.nodeClose();
+	CHECK(waiting.wait_for(2s) == std::future_status::ready);
+	CHECK(waiting.get().status == RequestStatus::Closed);
+	CHECK(!hub.open());
+
+	std::future<Reply> after = hub.request(kQTemp, kRTemp, 10s);
+	CHECK(after.wait_for(0ms) == std::future_status::ready);
+	CHECK(after.get().status == RequestStatus::Closed);
+}
+
+} // namespace
+
+int main()
+{
+	signal(SIGPIPE, SIG_IGN);
+	testRequest();
+	testCallbacks();
+	testTimeout();
+	testClosed();
+	return checkResult();
+}
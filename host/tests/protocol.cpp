@@ -0,0 +1,171 @@
+// FrameParser and the frame formatting, against each other and against
+// dump.bin, a capture of the firmware's own escaping (see data/dump.txt).
+
+#include <string>
+#include <vector>
+
+#include "Check.h"
+#include "sensorhub/Protocol.h"
+
+using namespace sensorhub;
+
+namespace {
+
+std::vector<Message> parseAll(FrameParser &parser, const std::string &bytes)
+{
+	std::vector<Message> frames;
+	for (char c : bytes)
+	{
+		if (parser.feed(c)) {
+			frames.push_back(Message(parser.frame()));
+		}
+	}
+	return frames;
+}
+
+std::vector<Message> parseAll(const std::string &bytes)
+{
+	FrameParser parser;
+	return parseAll(parser, bytes);
+}
+
+// every byte that needs it escaped, each way
+void testEscaping()
+{
+	const char text[] = {'a', ',', 'b', ';', 'c', '/', 'd', '\0', 'e'};
+	uint16_t bin = 0x2C3B;		// ';' then ',' on the wire
+	std::string out;
+	formatFrame(out, 5, std::string_view(text, sizeof(text)), binary(bin), 300, true);
+	const char expected[] = "5,a/,b/;c//d/\0e,/;/,,300,1;";
+	CHECK(out == std::string(expected, sizeof(expected) - 1));
+
+	std::vector<Message> frames = parseAll(out);
+	CHECK(frames.size() == 1);
+	if (frames.size() != 1) {
+		return;
+	}
+	Frame frame = frames[0].frame();
+	CHECK(frame.valid());
+	CHECK(frame.command() == 5);
+	CHECK(frame.args() == 4);
+	CHECK(frame.arg(0) == std::string_view(text, sizeof(text)));
+	uint16_t binBack = 0;
+	CHECK(frame.readBin(1, binBack) && binBack == bin);
+	uint32_t wrongSize;
+	CHECK(!frame.readBin(1, wrongSize));
+	int number = 0;
+	CHECK(frame.read(2, number) && number == 300);
+	bool flag = false;
+	CHECK(frame.read(3, flag) && flag);
+	CHECK(!frame.read(4, number));
+	CHECK(!frame.read(0, number));
+}
+
+// a frame only completes at its unescaped command separator, however the
+// bytes arrive, and the line ends between frames are skipped
+void testPartialFrames()
+{
+	std::string first, second;
+	uint32_t bin = 0x0A3B2C2F;		// '/' ',' ';' and a line end inside the frame
+	formatFrame(first, kRSampleBlock, binary(bin));
+	formatFrame(second, kRLux, 100, 3, 100000);
+	std::string wire = first + "\r\n" + second + "\r\n";
+
+	FrameParser parser;
+	std::vector<Message> frames;
+	for (size_t i = 0; i < wire.size(); i++)
+	{
+		bool done = parser.feed(wire[i]);
+		if (done) {
+			frames.push_back(Message(parser.frame()));
+		}
+		CHECK(done == (i == first.size() - 1 || i == wire.size() - 3));
+	}
+	CHECK(frames.size() == 2);
+	if (frames.size() == 2)
+	{
+		uint32_t binBack = 0;
+		CHECK(frames[0].frame().command() == kRSampleBlock);
+		CHECK(frames[0].frame().readBin(0, binBack) && binBack == bin);
+		CHECK(frames[1].frame().command() == kRLux && frames[1].frame().args() == 3);
+	}
+
+	// an escape as the last byte of one read escapes the first of the next
+	std::vector<Message> split = parseAll(parser, "20,a/");
+	CHECK(split.empty());
+	split = parseAll(parser, ";b;");
+	CHECK(split.size() == 1 && split[0].frame().arg(0) == "a;b");
+}
+
+// a frame too long for the buffer, or with too many arguments, is dropped
+// whole and the next one parses
+void testOverflow()
+{
+	FrameParser parser;
+	std::string longFrame = "44," + std::string(kMaxFrameSize, '7') + ";";
+	std::string manyArgs = "44";
+	for (size_t i = 0; i <= kMaxArgs; i++) {
+		manyArgs += ",1";
+	}
+	manyArgs += ";";
+	std::vector<Message> frames = parseAll(parser, longFrame + "\r\n" + manyArgs + "\r\n12,210;\r\n");
+	CHECK(parser.overflows() == 2);
+	CHECK(frames.size() == 1 && frames[0].frame().command() == 12);
+
+	// a first field that is not a command ID still ends a frame
+	frames = parseAll("x,1;256,1;13;");
+	CHECK(frames.size() == 3);
+	if (frames.size() == 3) {
+		CHECK(!frames[0].frame().valid() && !frames[1].frame().valid() && frames[2].frame().valid());
+	}
+}
+
+// dump.bin parses whole, and formatting what was parsed gives back the
+// firmware's bytes exactly, so both ends escape alike
+void testGolden()
+{
+	std::string capture = check::readData("dump.bin");
+	FrameParser parser;
+	std::vector<Message> frames = parseAll(parser, capture);
+	CHECK(parser.overflows() == 0);
+
+	std::string again;
+	size_t blocks = 0, ends = 0, escaped = 0;
+	for (const Message &message : frames)
+	{
+		Frame frame = message.frame();
+		CHECK(frame.valid());
+		again += std::to_string(frame.command());
+		for (size_t i = 0; i < frame.args(); i++) {
+			appendArg(again, frame.arg(i));
+		}
+		again += kCommandSeparator;
+		again += "\r\n";
+		if (frame.command() == kRSampleBlock)
+		{
+			blocks++;
+			std::string_view block = frame.arg(0);
+			for (char c : block) {
+				escaped += (c == '\0' || c == kFieldSeparator || c == kCommandSeparator || c == kEscapeCharacter);
+			}
+			CHECK(frame.args() == 1);
+		}
+		ends += (frame.command() == kRSampleDumpEnd);
+	}
+	CHECK(again == capture);
+	CHECK(blocks == 5);
+	CHECK(ends == 3);
+	// the first block's sequence number alone is four escaped NULs
+	CHECK(escaped > 4);
+}
+
+} // namespace
+
+int main()
+{
+	testEscaping();
+	testPartialFrames();
+	testOverflow();
+	testGolden();
+	return checkResult();
+}
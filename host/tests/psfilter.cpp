@@ -0,0 +1,148 @@
+// The firmware's PS filter, firmware/src/PSFilter.h, replayed over a
+// proximity trace: how often noise alone would turn the night light on,
+// for every median and shift the node accepts, and how soon a hand does.
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "Check.h"
+
+#include "PSFilter.h"
+
+namespace {
+
+// sensorPSTriggerH and sensorPSTriggerL in firmware/src/main.cpp
+constexpr uint16_t kTriggerH = 7;
+constexpr uint16_t kTriggerL = 5;
+
+constexpr size_t kSamples = 10000;		// one per 40 ms conversion, under 7 minutes
+
+// the same numbers on every run
+struct Lcg
+{
+	uint32_t state = 12345;
+	uint32_t next(uint32_t range)
+	{
+		state = state * 1103515245 + 12345;
+		return (state >> 16) % range;
+	}
+};
+
+// A calibrated sensor with nothing in front: 0 to 3 counts of noise, and
+// one conversion in 50 a spike of 8 to 200 counts. Every fifth spike is
+// two conversions long.
+std::vector<uint16_t> noiseTrace()
+{
+	Lcg random;
+	std::vector<uint16_t> trace;
+	while (trace.size() < kSamples)
+	{
+		if (random.next(50) != 0)
+		{
+			trace.push_back(uint16_t(random.next(4)));
+			continue;
+		}
+		uint16_t spike = uint16_t(8 + random.next(193));
+		trace.push_back(spike);
+		if (random.next(5) == 0) {
+			trace.push_back(spike);
+		}
+	}
+	trace.resize(kSamples);
+	return trace;
+}
+
+// the night light's hysteresis: on at kTriggerH, armed again at kTriggerL
+size_t triggers(const std::vector<uint16_t> &trace, uint8_t median, uint8_t shift)
+{
+	PsFilter filter;
+	psFilterInit(filter, median, shift);
+	bool near = false;
+	size_t count = 0;
+	for (uint16_t sample : trace)
+	{
+		uint16_t ps = psFilterUpdate(filter, sample);
+		if (ps >= kTriggerH)
+		{
+			count += !near;
+			near = true;
+		}
+		else if (ps <= kTriggerL) {
+			near = false;
+		}
+	}
+	return count;
+}
+
+// conversions from a hand arriving, 40 counts held, to the first trigger
+size_t handLatency(uint8_t median, uint8_t shift)
+{
+	PsFilter filter;
+	psFilterInit(filter, median, shift);
+	for (size_t i = 0; i < 20; i++) {
+		psFilterUpdate(filter, 1);
+	}
+	for (size_t i = 1; i <= 50; i++)
+	{
+		if (psFilterUpdate(filter, 40) >= kTriggerH) {
+			return i;
+		}
+	}
+	return SIZE_MAX;
+}
+
+// false triggers per 10000 conversions for every setting; the median cuts
+// them, and more of it or more averaging never lets more through
+void testFalseTriggers()
+{
+	std::vector<uint16_t> trace = noiseTrace();
+	size_t rate[PS_FILTER_MEDIAN_MAX + 1][PS_FILTER_SHIFT_MAX + 1] = {};
+	for (uint8_t median = 1; median <= PS_FILTER_MEDIAN_MAX; median += 2)
+	{
+		for (uint8_t shift = 0; shift <= PS_FILTER_SHIFT_MAX; shift++)
+		{
+			CHECK(psFilterValid(median, shift));
+			rate[median][shift] = triggers(trace, median, shift);
+			std::printf("median %u shift %u: %zu false triggers\n", median, shift, rate[median][shift]);
+			if (shift > 0) {
+				CHECK(rate[median][shift] <= rate[median][shift - 1]);
+			}
+			if (median > 1) {
+				CHECK(rate[median][shift] <= rate[median - 2][shift]);
+			}
+		}
+	}
+	// unfiltered, nearly every one of the 200 or so spikes is a trigger
+	CHECK(rate[1][0] > 180);
+	// the default, median 3 and shift 2, still lets the two conversion
+	// spikes through, a fifth of them
+	CHECK(rate[3][2] <= rate[1][0] / 4);
+	// through the median of 5 only spikes that come close together
+	CHECK(rate[5][2] <= 5);
+}
+
+// the filter that keeps noise out still sees a hand within a few
+// conversions, 160 ms at the default
+void testHand()
+{
+	for (uint8_t median = 1; median <= PS_FILTER_MEDIAN_MAX; median += 2)
+	{
+		for (uint8_t shift = 0; shift <= PS_FILTER_SHIFT_MAX; shift++)
+		{
+			size_t latency = handLatency(median, shift);
+			CHECK(latency <= size_t(median / 2 + 1 + shift * 3));
+		}
+	}
+	CHECK(handLatency(1, 0) == 1);
+	CHECK(handLatency(3, 2) <= 4);
+}
+
+} // namespace
+
+int main()
+{
+	testFalseTriggers();
+	testHand();
+	return checkResult();
+}
@@ -0,0 +1,273 @@
+// The sample block decoder and SampleDumpCursor against the firmware's own
+// encoder, firmware/src/SampleDump.h, built here with the native
+// util/crc16.h, and against the blocks in dump.bin (see data/dump.txt).
+
+#include <string>
+#include <vector>
+
+#include "Check.h"
+#include "sensorhub/Protocol.h"
+#include "sensorhub/SampleDump.h"
+
+// the firmware's Sample and SampleRing, in the global namespace
+#include "Samples.h"
+#include "SampleDump.h"
+
+using sensorhub::DumpError;
+using sensorhub::SampleBlock;
+using sensorhub::SampleDumpCursor;
+using sensorhub::decodeSampleBlock;
+
+namespace {
+
+static_assert(SAMPLE_DUMP_FORMAT == sensorhub::kSampleDumpFormat, "block format differs from the firmware's");
+static_assert(SAMPLE_CHANNELS == sensorhub::kSampleChannels, "channel count differs from the firmware's");
+static_assert(SAMPLE_PRESSURE_OFFSET == sensorhub::kSamplePressureOffset, "pressure offset differs from the firmware's");
+
+std::vector<uint8_t> encode(const SampleRing &ring, uint32_t seq)
+{
+	uint8_t block[SAMPLE_DUMP_BLOCK_MAX];
+	uint8_t len = sampleDumpBlock(ring, seq, block);
+	return std::vector<uint8_t>(block, block + len);
+}
+
+// the decoded block holds what the ring does from its first sequence number
+bool matches(const SampleRing &ring, const SampleBlock &block)
+{
+	for (const sensorhub::Sample &sample : block.samples)
+	{
+		const Sample &original = sampleAt(ring, uint8_t(ring.total - 1 - sample.seq));
+		if (sample.time != original.time) {
+			return false;
+		}
+		for (size_t c = 0; c < SAMPLE_CHANNELS; c++)
+		{
+			if (sample.value[c] != original.value[c]) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+// puts the CRC right again after a block has been changed on purpose
+void recrc(std::vector<uint8_t> &block)
+{
+	uint16_t crc = sensorhub::crc16(block.data(), block.size() - 2);
+	block[block.size() - 2] = uint8_t(crc);
+	block[block.size() - 1] = uint8_t(crc >> 8);
+}
+
+// every difference from every value on one channel, and varints of one to
+// three bytes on the others, wrapping at 16 bits both ways
+void testVarintZigZag()
+{
+	const uint16_t edges[] = {0, 1, 0x3F, 0x40, 0x7F, 0x80, 0x1FFF, 0x2000, 0x3FFF, 0x4000, 0x7FFF, 0x8000, 0xFFFE, 0xFFFF};
+	const size_t edgeCount = sizeof(edges) / sizeof(edges[0]);
+	SampleRing ring = {};
+	unsigned bad = 0;
+	for (uint32_t i = 0; i < 0x10000; i++)
+	{
+		uint16_t values[SAMPLE_CHANNELS];
+		values[0] = uint16_t(i * 40503);		// odd, so every value comes up once
+		for (uint8_t c = 1; c < SAMPLE_CHANNELS; c++) {
+			values[c] = edges[(i * c + i / edgeCount) % edgeCount];
+		}
+		samplePush(ring, uint16_t(i * 4099), values);
+		if (ring.total % SAMPLE_DUMP_BLOCK_SAMPLES != 0) {
+			continue;
+		}
+		SampleBlock block;
+		std::vector<uint8_t> data = encode(ring, ring.total - SAMPLE_DUMP_BLOCK_SAMPLES);
+		if (decodeSampleBlock(data, block) != DumpError::None || block.samples.size() != SAMPLE_DUMP_BLOCK_SAMPLES || !matches(ring, block)) {
+			bad++;
+		}
+	}
+	CHECK(bad == 0);
+}
+
+// CRC-16/ARC from 0xFFFF, as _crc16_update, and any one bit wrong is caught
+void testCrc()
+{
+	const uint8_t check[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+	uint16_t crc = 0xFFFF;
+	for (uint8_t b : check) {
+		crc = _crc16_update(crc, b);
+	}
+	CHECK(crc == 0x4B37);
+	CHECK(sensorhub::crc16(check, sizeof(check)) == crc);
+
+	SampleRing ring = {};
+	for (uint16_t i = 0; i < 5; i++)
+	{
+		uint16_t values[SAMPLE_CHANNELS] = {uint16_t(210 + i), 45, 51325, uint16_t(100 * i), 10};
+		samplePush(ring, uint16_t(60 * i), values);
+	}
+	std::vector<uint8_t> good = encode(ring, 0);
+	SampleBlock block;
+	CHECK(decodeSampleBlock(good, block) == DumpError::None && block.samples.size() == 5);
+
+	unsigned missed = 0;
+	for (size_t bit = 0; bit < good.size() * 8; bit++)
+	{
+		std::vector<uint8_t> bad = good;
+		bad[bit / 8] ^= uint8_t(1 << (bit % 8));
+		missed += (decodeSampleBlock(bad, block) != DumpError::BadCrc);
+	}
+	CHECK(missed == 0);
+	CHECK(block.samples.empty());
+
+	std::vector<uint8_t> cut(good.begin(), good.end() - 1);
+	CHECK(decodeSampleBlock(cut, block) == DumpError::BadCrc);
+	cut.resize(8);
+	CHECK(decodeSampleBlock(cut, block) == DumpError::Truncated);
+}
+
+// blocks that pass the CRC but do not add up
+void testMalformed()
+{
+	SampleRing ring = {};
+	uint16_t values[SAMPLE_CHANNELS] = {210, 45, 51325, 100, 10};
+	samplePush(ring, 60, values);
+	samplePush(ring, 120, values);
+	const std::vector<uint8_t> good = encode(ring, 0);
+	SampleBlock block;
+
+	std::vector<uint8_t> bad = good;
+	bad[0] = SAMPLE_DUMP_FORMAT + 1;
+	recrc(bad);
+	CHECK(decodeSampleBlock(bad, block) == DumpError::BadFormat);
+
+	bad = good;
+	bad[1] = SAMPLE_CHANNELS - 1;
+	recrc(bad);
+	CHECK(decodeSampleBlock(bad, block) == DumpError::BadFormat);
+
+	bad = good;
+	bad[2]++;
+	recrc(bad);
+	CHECK(decodeSampleBlock(bad, block) == DumpError::Truncated);
+
+	bad = good;
+	bad[2]--;
+	recrc(bad);
+	CHECK(decodeSampleBlock(bad, block) == DumpError::TrailingBytes);
+
+	// a varint that runs past 16 bits
+	bad = {SAMPLE_DUMP_FORMAT, SAMPLE_CHANNELS, 1, 0, 0, 0, 0, 0x80, 0x80, 0x80, 0x01, 0, 0, 0, 0, 0, 0, 0};
+	recrc(bad);
+	CHECK(decodeSampleBlock(bad, block) == DumpError::Truncated);
+}
+
+// the firmware loop: the next block from where the last one ended. Past a
+// wrap the first block starts at the oldest sample and the cursor counts
+// the ones it never saw; a node that restarts sends the cursor back to 0.
+void testCursor()
+{
+	SampleRing ring = {};
+	SampleDumpCursor cursor;
+	uint16_t values[SAMPLE_CHANNELS] = {210, 45, 51325, 100, 10};
+	for (uint16_t i = 0; i < SAMPLE_RING_SIZE + 5; i++) {
+		samplePush(ring, i, values);
+	}
+	SampleBlock block;
+	size_t blocks = 0;
+	for (std::vector<uint8_t> data = encode(ring, cursor.next()); !data.empty(); data = encode(ring, cursor.next()))
+	{
+		CHECK(decodeSampleBlock(data, block) == DumpError::None);
+		CHECK(matches(ring, block));
+		CHECK(blocks > 0 || block.firstSeq == sampleDumpOldest(ring));
+		CHECK(cursor.accept(block));
+		blocks++;
+	}
+	CHECK(blocks == SAMPLE_RING_SIZE / SAMPLE_DUMP_BLOCK_SAMPLES);
+	CHECK(cursor.missed() == 5);
+	CHECK(!cursor.end(ring.total, sampleDumpOldest(ring), ring.total));
+	CHECK(cursor.next() == ring.total);
+
+	// the same block again is old news
+	CHECK(!cursor.accept(block));
+	CHECK(cursor.next() == ring.total && cursor.missed() == 5);
+
+	// after a restart the node's total is below where the cursor had got to
+	SampleRing restarted = {};
+	samplePush(restarted, 0, values);
+	CHECK(encode(restarted, cursor.next()).empty());
+	CHECK(cursor.end(cursor.next(), sampleDumpOldest(restarted), restarted.total));
+	CHECK(cursor.next() == 0);
+	CHECK(decodeSampleBlock(encode(restarted, cursor.next()), block) == DumpError::None);
+	CHECK(cursor.accept(block) && cursor.next() == 1);
+}
+
+// the blocks in dump.bin, and the cursor over the two dumps in it
+void testGolden()
+{
+	std::string capture = check::readData("dump.bin");
+	sensorhub::FrameParser parser;
+	std::vector<SampleBlock> blocks;
+	std::vector<std::vector<uint32_t>> ends;
+	for (char c : capture)
+	{
+		if (!parser.feed(c)) {
+			continue;
+		}
+		sensorhub::Frame frame = parser.frame();
+		if (frame.command() == sensorhub::kRSampleBlock)
+		{
+			std::string_view data = frame.arg(0);
+			SampleBlock block;
+			CHECK(decodeSampleBlock(reinterpret_cast<const uint8_t *>(data.data()), data.size(), block) == DumpError::None);
+			blocks.push_back(block);
+		}
+		else if (frame.command() == sensorhub::kRSampleDumpEnd)
+		{
+			std::vector<uint32_t> end(3);
+			CHECK(frame.read(0, end[0]) && frame.read(1, end[1]) && frame.read(2, end[2]));
+			ends.push_back(end);
+		}
+	}
+	CHECK(blocks.size() == 5 && ends.size() == 3);
+	if (blocks.size() != 5 || ends.size() != 3) {
+		return;
+	}
+
+	// one sample a minute; the lux set at 90 s is in the one at 120 s
+	const sensorhub::Sample &first = blocks[0].samples[0];
+	CHECK(first.seq == 0 && first.time == 60);
+	CHECK(first.value[sensorhub::kChannelTemperature] == 210 && first.value[sensorhub::kChannelLux] == 100);
+	CHECK(first.pressurePa() == 101325);
+	CHECK(blocks[0].samples[1].value[sensorhub::kChannelLux] == 2000);
+	CHECK(blocks[0].samples[7].pressurePa() == 59998);
+
+	// the whole history, then from 8 again
+	SampleDumpCursor cursor;
+	CHECK(cursor.accept(blocks[0]) && cursor.accept(blocks[1]));
+	CHECK(!cursor.end(ends[0][0], ends[0][1], ends[0][2]));
+	CHECK(cursor.next() == 11 && cursor.missed() == 0);
+	CHECK(!cursor.accept(blocks[2]));
+	CHECK(!cursor.end(ends[1][0], ends[1][1], ends[1][2]));
+
+	// asked from 0 once 4 samples have left the ring
+	SampleDumpCursor late;
+	CHECK(blocks[3].firstSeq == 4 && late.accept(blocks[3]) && late.missed() == 4);
+	CHECK(late.accept(blocks[4]) && late.next() == 20);
+	CHECK(!late.end(ends[2][0], ends[2][1], ends[2][2]));
+	CHECK(late.next() == 20);
+
+	// the first dump seen by a cursor from before a restart
+	SampleDumpCursor stale(100);
+	CHECK(stale.end(ends[0][0], ends[0][1], ends[0][2]));
+	CHECK(stale.next() == 0);
+}
+
+} // namespace
+
+int main()
+{
+	testVarintZigZag();
+	testCrc();
+	testMalformed();
+	testCursor();
+	testGolden();
+	return checkResult();
+}
@@ -0,0 +1,131 @@
+// readTrace, isTraceQuery and FrameSplitter against trace.bin, two kQTrace
+// dumps from a SYS_TRACE build (see data/trace.txt), and dump.bin.
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Check.h"
+#include "sensorhub/Protocol.h"
+#include "sensorhub/Trace.h"
+
+using namespace sensorhub;
+
+namespace {
+
+constexpr size_t kTraceFrameMax = 48;	// TRACE_FRAME_MAX in firmware/src/Trace.h
+
+std::vector<std::string> split(const std::string &bytes)
+{
+	FrameSplitter splitter;
+	std::vector<std::string> frames;
+	for (char c : bytes)
+	{
+		if (splitter.feed(c)) {
+			frames.push_back(splitter.frame());
+		}
+	}
+	return frames;
+}
+
+// the trace holds each frame as it went over the wire, so what the node
+// sent before the first dump is what FrameSplitter finds in the capture
+void testTrace()
+{
+	std::string capture = check::readData("trace.bin");
+	std::istringstream in(capture);
+	Trace trace;
+	CHECK(readTrace(in, trace));
+	CHECK(trace.dumps == 2);
+	CHECK(trace.dropped == 6);
+
+	std::vector<TraceFrame> in1, out1;
+	size_t queries = 0;
+	size_t firstDump = 0;
+	for (size_t i = 0; i < trace.frames.size(); i++)
+	{
+		const TraceFrame &frame = trace.frames[i];
+		CHECK(i == 0 || frame.time >= trace.frames[i - 1].time);
+		if (isTraceQuery(frame))
+		{
+			queries++;
+			if (queries == 1) {
+				firstDump = i + 1;
+			}
+		}
+		else if (queries == 0) {
+			(frame.out ? out1 : in1).push_back(frame);
+		}
+	}
+	CHECK(queries == 2);
+	CHECK(isTraceQuery(trace.frames.back()));
+	CHECK(firstDump == 10);
+
+	std::vector<std::string> sent;
+	for (const std::string &frame : split(capture))
+	{
+		if (frame.compare(0, 3, "65,") == 0) {
+			break;
+		}
+		sent.push_back(frame);
+	}
+	CHECK(out1.size() == sent.size());
+	for (size_t i = 0; i < out1.size() && i < sent.size(); i++) {
+		CHECK(!out1[i].truncated && out1[i].data == sent[i]);
+	}
+
+	const std::string status = "0,123456789012345678901234567890123456789012345678901234567890;";
+	const char *received[] = {"6;", "17;", "43,3,0,2;"};
+	CHECK(in1.size() == 4);
+	if (in1.size() == 4)
+	{
+		for (size_t i = 0; i < 3; i++) {
+			CHECK(!in1[i].truncated && in1[i].data == received[i] && in1[i].matches(received[i]));
+		}
+		CHECK(in1[3].truncated && in1[3].data.size() == kTraceFrameMax);
+		CHECK(in1[3].matches(status));
+		CHECK(!in1[3].matches("0,9" + status.substr(3)));
+		CHECK(!in1[0].matches("6;7;"));
+	}
+	TraceFrame reply;
+	reply.out = true;
+	reply.data = "64;";
+	CHECK(!isTraceQuery(reply));
+}
+
+// FrameSplitter cuts a capture where FrameParser does, escaped separators
+// and the bare line ends in binary arguments included, and leaves out only
+// the line ends between frames
+void testSplitter(const char *name)
+{
+	std::string capture = check::readData(name);
+	std::vector<std::string> frames = split(capture);
+	std::string joined;
+	size_t parsed = 0;
+	FrameParser whole;
+	for (char c : capture) {
+		parsed += whole.feed(c);
+	}
+	for (const std::string &frame : frames)
+	{
+		joined += frame + "\r\n";
+		FrameParser parser;
+		size_t done = 0;
+		for (char c : frame) {
+			done += parser.feed(c);
+		}
+		CHECK(done == 1 && parser.frame().valid());
+	}
+	CHECK(frames.size() == parsed);
+	CHECK(joined == capture);
+}
+
+} // namespace
+
+int main()
+{
+	testTrace();
+	testSplitter("trace.bin");
+	testSplitter("dump.bin");
+	return checkResult();
+}
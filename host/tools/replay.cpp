@@ -0,0 +1,263 @@
+// sensorhub-replay - plays a captured serial trace into the native firmware
+// build and compares what it sends back with what the node sent.
+//
+//   sensorhub-replay [-s speed] [-w ms] trace.txt program [args...]
+//
+// trace.txt is the node's reply to kQTrace, as captured on the hub; other
+// traffic in the capture is skipped, and so is the kQTrace itself. The
+// program is started with its stdin and stdout on pipes, so environment
+// settings like SENSORHUB_EEPROM carry through. Once it has sent its first frame, the inbound frames go to it
+// with the gaps they had on the node, divided by the speed (0 sends them
+// back to back). After the last one it has -w ms (1000) to finish
+// answering, then it is stopped.
+//
+// The output is a diff of the node's frames against the replay's, from the
+// first inbound frame on, then the time from each inbound frame to the
+// next frame sent back, on the node and in the replay. The exit status is
+// 1 if the frames differ.
+
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "sensorhub/Trace.h"
+
+using namespace sensorhub;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct ReplayFrame
+{
+	double time;		// ms since the first inbound frame went out
+	std::string data;
+};
+
+struct Child
+{
+	pid_t pid = -1;
+	int in = -1;		// its stdin
+	int out = -1;		// its stdout
+};
+
+void usage()
+{
+	std::fprintf(stderr, "usage: sensorhub-replay [-s speed] [-w ms] trace.txt program [args...]\n");
+	std::exit(2);
+}
+
+bool start(char **argv, Child &child)
+{
+	int toChild[2], fromChild[2];
+	if (pipe(toChild) != 0 || pipe(fromChild) != 0) {
+		return false;
+	}
+	child.pid = fork();
+	if (child.pid < 0) {
+		return false;
+	}
+	if (child.pid == 0)
+	{
+		dup2(toChild[0], STDIN_FILENO);
+		dup2(fromChild[1], STDOUT_FILENO);
+		close(toChild[0]);
+		close(toChild[1]);
+		close(fromChild[0]);
+		close(fromChild[1]);
+		execvp(argv[0], argv);
+		std::perror(argv[0]);
+		_exit(127);
+	}
+	close(toChild[0]);
+	close(fromChild[1]);
+	child.in = toChild[1];
+	child.out = fromChild[0];
+	return true;
+}
+
+// ms since a point in time, as a double so fast replies keep their fraction
+double since(Clock::time_point from)
+{
+	return std::chrono::duration<double, std::milli>(Clock::now() - from).count();
+}
+
+// reads what the program has sent until the deadline; false once it has
+// closed its end
+bool collect(Child &child, FrameSplitter &splitter, Clock::time_point origin,
+	Clock::time_point deadline, std::vector<ReplayFrame> &frames)
+{
+	for (;;)
+	{
+		auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count();
+		if (left < 0) {
+			return true;
+		}
+		pollfd pfd = {child.out, POLLIN, 0};
+		if (poll(&pfd, 1, int(left)) <= 0) {
+			continue;
+		}
+		char buffer[256];
+		ssize_t n = read(child.out, buffer, sizeof(buffer));
+		if (n <= 0) {
+			return false;
+		}
+		for (ssize_t i = 0; i < n; i++)
+		{
+			if (splitter.feed(buffer[i])) {
+				frames.push_back({since(origin), splitter.frame()});
+			}
+		}
+	}
+}
+
+// longest common subsequence of the node's outbound frames and the replay's,
+// printed as a diff: "  " both, "- " node only, "+ " replay only
+size_t diff(const std::vector<const TraceFrame *> &node, const std::vector<ReplayFrame> &replay)
+{
+	size_t n = node.size(), m = replay.size();
+	std::vector<std::vector<uint32_t>> lcs(n + 1, std::vector<uint32_t>(m + 1, 0));
+	for (size_t i = n; i-- > 0;)
+	{
+		for (size_t j = m; j-- > 0;) {
+			lcs[i][j] = node[i]->matches(replay[j].data) ? lcs[i + 1][j + 1] + 1 : std::max(lcs[i + 1][j], lcs[i][j + 1]);
+		}
+	}
+	size_t differences = 0;
+	size_t i = 0, j = 0;
+	while (i < n || j < m)
+	{
+		if (i < n && j < m && node[i]->matches(replay[j].data)) {
+			std::printf("  %s\n", replay[j].data.c_str());
+			i++;
+			j++;
+		}
+		else if (i < n && (j == m || lcs[i + 1][j] >= lcs[i][j + 1])) {
+			std::printf("- %s%s\n", node[i]->data.c_str(), node[i]->truncated ? "..." : "");
+			differences++;
+			i++;
+		}
+		else {
+			std::printf("+ %s\n", replay[j].data.c_str());
+			differences++;
+			j++;
+		}
+	}
+	return differences;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+	double speed = 1;
+	double settle = 1000;
+	int opt;
+	while ((opt = getopt(argc, argv, "+s:w:")) != -1)
+	{
+		switch (opt)
+		{
+			case 's':
+				speed = std::atof(optarg);
+				break;
+			case 'w':
+				settle = std::atof(optarg);
+				break;
+			default:
+				usage();
+		}
+	}
+	if (argc - optind < 2 || speed < 0) {
+		usage();
+	}
+
+	std::ifstream file(argv[optind]);
+	Trace trace;
+	if (!file || !readTrace(file, trace)) {
+		std::fprintf(stderr, "sensorhub-replay: no trace in %s\n", argv[optind]);
+		return 2;
+	}
+	auto first = std::find_if(trace.frames.begin(), trace.frames.end(), [](const TraceFrame &f) { return !f.out; });
+	if (first == trace.frames.end()) {
+		std::fprintf(stderr, "sensorhub-replay: no inbound frames in %s\n", argv[optind]);
+		return 2;
+	}
+	if (trace.dropped) {
+		std::printf("# the node lost %u frames to a full ring\n", unsigned(trace.dropped));
+	}
+
+	signal(SIGPIPE, SIG_IGN);
+	Child child;
+	if (!start(argv + optind + 1, child)) {
+		std::perror("sensorhub-replay");
+		return 2;
+	}
+
+	// wait for the firmware to come up, then play from the first inbound frame
+	FrameSplitter splitter;
+	std::vector<ReplayFrame> boot, replay;
+	bool running = true;
+	Clock::time_point origin = Clock::now();
+	while (running && boot.empty()) {
+		running = collect(child, splitter, origin, Clock::now() + std::chrono::milliseconds(100), boot);
+	}
+	origin = Clock::now();
+	std::vector<double> sent;
+	for (auto it = first; running && it != trace.frames.end(); ++it)
+	{
+		if (it->out || isTraceQuery(*it)) {
+			continue;
+		}
+		double at = (speed > 0) ? (it->time - first->time) / speed : 0;
+		running = collect(child, splitter, origin, origin + std::chrono::microseconds(int64_t(at * 1000)), replay);
+		sent.push_back(since(origin));
+		if (write(child.in, it->data.data(), it->data.size()) != ssize_t(it->data.size())) {
+			running = false;
+		}
+	}
+	if (running) {
+		collect(child, splitter, origin, Clock::now() + std::chrono::microseconds(int64_t(settle * 1000)), replay);
+	}
+	close(child.in);
+	kill(child.pid, SIGTERM);
+	waitpid(child.pid, nullptr, 0);
+
+	std::vector<const TraceFrame *> node, inbound;
+	for (auto it = first; it != trace.frames.end(); ++it)
+	{
+		if (it->out) {
+			node.push_back(&*it);
+		}
+		else if (!isTraceQuery(*it)) {
+			inbound.push_back(&*it);
+		}
+	}
+	size_t differences = diff(node, replay);
+
+	// latency: inbound frame, then ms to the next reply on the node and in the replay
+	std::printf("\n%-24s %10s %10s\n", "inbound", "node ms", "replay ms");
+	size_t k = 0;
+	for (size_t i = 0; i < inbound.size(); i++)
+	{
+		auto reply = std::find_if(node.begin(), node.end(), [&](const TraceFrame *f) { return f->time >= inbound[i]->time; });
+		while (k < replay.size() && replay[k].time < sent[i]) {
+			k++;
+		}
+		std::string nodeMs = (reply != node.end()) ? std::to_string((*reply)->time - inbound[i]->time) : "-";
+		char replayMs[16] = "-";
+		if (i < sent.size() && k < replay.size()) {
+			std::snprintf(replayMs, sizeof(replayMs), "%.1f", replay[k].time - sent[i]);
+		}
+		std::printf("%-24s %10s %10s\n", inbound[i]->data.c_str(), nodeMs.c_str(), replayMs);
+	}
+	std::printf("\n%zu node frames, %zu replay frames, %zu differences\n", node.size(), replay.size(), differences);
+	return differences ? 1 : 0;
+}